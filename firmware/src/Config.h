@@ -5,17 +5,74 @@
 #define NUM_STEPS 16
 #define MAX_PATTERNS 64
 #define MAX_SONG_LENGTH 128
+#define UNDO_DEPTH 64      // Edit records kept in the undo journal
+#define EDIT_QUEUE_SIZE 32 // UI -> Engine edits in flight (power of two)
 
 // --- TIMING ---
-#define PULSE_WIDTH_MS 15
+#define PPQN 96
+#define TICKS_PER_STEP 24  // 16th note at 96 PPQN
+#define MAX_SWING_TICKS 12 // Swing delay at 100%
+#define PULSE_WIDTH_MS 15     // Default gate length per track
+#define MAX_PULSE_WIDTH_MS 250
 #define DEFAULT_BPM 120
 
+// --- CLOCK SCHEDULER ---
+// Event mode reprograms a one-shot timer for the exact time of the next
+// PPQN tick or gate-off. Comment out to fall back to the fixed 2kHz poll.
+#define CLOCK_EVENT_SCHEDULER
+#define CLOCK_POLL_INTERVAL_US 500
+#define CLOCK_IDLE_INTERVAL_US 10000 // Event mode wake-up when nothing is due
+#define CLOCK_MIN_DELAY_US 2         // Shortest one-shot the timer accepts
+
+// --- CLOCK LOOKAHEAD ---
+// loop() renders this far ahead; the ISR only plays the result. It must
+// cover the longest main-loop stall (a full OLED refresh is ~25ms).
+#define CLOCK_LOOKAHEAD_US 30000
+#define CLOCK_START_DELAY_US 1000 // First tick after PLAY
+#define CLOCK_EVENT_QUEUE_SIZE 64 // Rendered events in flight (power of two)
+
+// --- CLOCK SYNC ---
+// Slave mode: a software PLL follows external clock pulses. Each pulse is
+// compared with the tick rendered for it, and the tick period is the
+// measured pulse period plus a share of that phase error.
+#define CLOCK_PULSE_IN_PPQN 24   // Pulses per quarter on PIN_CLOCK_IN (MIDI is always 24)
+#define SYNC_PERIOD_SHIFT 3       // Period filter weight 1/8 per pulse
+#define SYNC_PHASE_SHIFT 4        // 1/16 of the phase error corrected per pulse
+#define SYNC_LOCK_WINDOW_US 1500  // Phase error that still counts as in lock
+#define SYNC_LOCK_PULSES 8        // In-window pulses in a row to lock
+#define SYNC_UNLOCK_PULSES 4      // Out-of-window pulses in a row to unlock
+#define SYNC_TIMEOUT_MS 500       // No pulse for this long: unlocked (freewheel)
+#define SYNC_EVENT_QUEUE_SIZE 32  // Pulses and transport messages in flight (power of two)
+#define SYNC_HISTORY 16           // Rendered pulse ticks kept for the phase compare (power of two)
+
+// --- MIDI OUTPUT ---
+// USB device MIDI (platformio.ini builds with USB_MIDI_SERIAL). The clock
+// ISR queues 24 PPQN clock (every PPQN / 24 ticks), Start and Song
+// Position as they are played; the software interrupt sends them with
+// send_now() as soon as the clock ISR returns.
+// Comment out MIDI_OUT for a build without USB MIDI.
+#define MIDI_OUT
+#define MIDI_CLOCK_DIVIDER (PPQN / 24)
+#define MIDI_OUT_QUEUE_SIZE 64 // Messages in flight (power of two)
+#define MIDI_IRQ_PRIORITY 176  // NVIC priority of the send interrupt (PIT runs at 128)
+// Note on/off per track, mirroring the gate outputs: on when a gate opens,
+// off when it closes. Channel and note are set per track in the model.
+#ifdef MIDI_OUT
+#define MIDI_NOTE_OUT
+#endif
+#define MIDI_NOTE_CHANNEL 10   // Default for every track (GM drums)
+#define MIDI_NOTE_VELOCITY 100
+// Uncomment to print "MIDI CLK <due us> <sent us>" over USB serial for
+// every clock message sent
+// #define MIDI_CLOCK_LOG
+
 // --- HARDWARE MAPPING ---
 const int OUTPUT_MAP[NUM_TRACKS] = {25, 26, 27, 28, 29, 30, 31, 32};
 
 // --- INPUTS ---
 const int PIN_POT_TEMPO = 14;
 const int PIN_POT_PARAM = 15;
+const int PIN_CLOCK_IN = 2; // External pulse clock (3.3V logic, rising edge)
 
 // KEY MATRIX PINS
 // Rows (Active Low Output)
@@ -34,6 +91,38 @@ const int PIN_COL_6 = 37;
 const int PIN_COL_7 = 35;
 const int PIN_COL_8 = 33;
 
+// KEY MATRIX SCAN
+// A timer ISR services one row per interrupt: read the row driven last
+// time (so it has settled for a full period), release it, drive the next.
+// Each key is sampled every 4 * KEY_SCAN_ROW_US (2ms) into an integrator
+// that counts up while pressed and down while released. The key only
+// changes state at 0 or KEY_DEBOUNCE_SAMPLES, so bounce just wobbles it.
+// The scan has a GPT interrupt of its own below the PIT: a clock tick
+// preempts it, and a late row only stretches that key's sample period.
+#define KEY_SCAN_ROW_US 500
+#define KEY_SCAN_IRQ_PRIORITY 192 // NVIC priority (PIT runs at 128)
+#define KEY_DEBOUNCE_SAMPLES 4
+#define KEY_HOLD_MS 500   // Held this long: one HOLD event
+#define KEY_REPEAT_MS 100 // Then a REPEAT event this often until release
+#define KEY_EVENT_QUEUE_SIZE 16 // Debounced presses in flight (power of two)
+
+// POT SAMPLING
+// Each pot has an ADC of its own converting continuously in the background
+// (12-bit, 32x hardware averaging, slowest clocks: roughly 10k results/s).
+// The ADC interrupt sums ADC_DECIMATION results into one 16-bit sample and
+// feeds it through a first-order IIR, so AnalogInput only reads the latest
+// value. The ADC IRQs run below the PIT priority and never delay a tick.
+#define ADC_DECIMATION 16   // 12-bit results summed per 16-bit sample
+#define ADC_IIR_SHIFT 3     // Filter weight 1/8 per sample (~600 samples/s)
+#define ADC_IRQ_PRIORITY 240 // NVIC priority (PIT runs at 128)
+
+// Adaptive hysteresis, in 16-bit sample units: tight while the knob is
+// moving so fine adjustments follow it, widening once it rests so noise
+// can't walk the value
+#define POT_BAND_MIN 24
+#define POT_BAND_MAX 160
+#define POT_BAND_SETTLE_MS 250 // Time at rest to go from MIN to MAX
+
 // PCB REVISION NOTES
 const bool POT_INVERT_POLARITY = true;
 
@@ -43,4 +132,42 @@ const bool POT_INVERT_POLARITY = true;
 
 // --- DISPLAY ---
 #define TRACK_EDIT_STR "<"
-#define TRACK_PERFORM_STR "*"
\ No newline at end of file
+#define TRACK_PERFORM_STR "*"
+
+// OLED geometry: 8 pages of 128 columns, one byte per column per page
+#define OLED_PAGES 8
+#define OLED_PAGE_BYTES 128
+#define OLED_PAGE_TILES 16 // 8x8 tiles per page
+
+// Display transfer: frames go out in chunks of up to DISPLAY_CHUNK_TILES
+// tiles, and each loop() pass spends at most DISPLAY_BUDGET_US on it.
+// One 4-tile chunk is roughly 1ms of I2C at 400kHz, so the budget caps
+// the display stall at about one chunk.
+#define DISPLAY_CHUNK_TILES 4
+#define DISPLAY_BUDGET_US 1000
+#define DISPLAY_FRAME_MS 33 // Fastest redraw rate; frames are only drawn on change
+
+// Timed UI elements (the only redraws not caused by a state change)
+#define CURSOR_BLINK_MS 500
+#define TRANSITION_BLINK_MS 150
+#define OVERLAY_TIMEOUT_MS 1500
+
+// --- STEP LEDS ---
+// Binary code modulation: bit plane b is latched for LED_BCM_BASE_US << b,
+// so LED_BCM_BITS planes give 2^bits brightness levels per frame of
+// (2^bits - 1) * base. 4 bits at 64us is ~1kHz refresh from 4 short ISRs
+// per frame (one transfer16 each, ~3us at 8MHz): about 1.3% CPU. The
+// refresh runs on a GPT interrupt below the PIT, so it never delays a
+// clock tick. Comment out LED_BCM for plain on/off LEDs written from loop().
+#define LED_BCM
+#define LED_BCM_BITS 4
+#define LED_BCM_BASE_US 64
+#define LED_BCM_IRQ_PRIORITY 160 // NVIC priority (PIT runs at 128)
+#define LED_SPI_CLOCK_HZ 8000000
+
+// Brightness levels used by the view (0 - LED_LEVEL_MAX)
+#define LED_LEVEL_MAX ((1 << LED_BCM_BITS) - 1)
+#define LED_LEVEL_PLAYHEAD LED_LEVEL_MAX
+#define LED_LEVEL_STEP 6
+#define LED_LEVEL_SWUNG 2
+#define LED_LEVEL_MARKER 1
@@ -1,39 +1,126 @@
 #include "AnalogInput.h"
+#include "Debug.h"
 
-AnalogInput::AnalogInput(int pin, int minOut, int maxOut, int threshold)
-    : _pin(pin), _minOut(minOut), _maxOut(maxOut), _threshold(threshold)
+#define SAMPLE_MAX 65535 // 4 extra bits from ADC_DECIMATION 12-bit results
+
+ADC AnalogInput::_adc;
+AnalogInput *AnalogInput::_channels[2] = {nullptr, nullptr};
+
+AnalogInput::AnalogInput(int pin, int minOut, int maxOut)
+    : _pin(pin), _minOut(minOut), _maxOut(maxOut)
+{
+  _module = nullptr;
+  _accum = 0;
+  _accumCount = 0;
+  _filtered = 0;
+  _primed = false;
+
+  _lastStableRaw = 0;
+  _lastMoveTime = 0;
+  _currentMapped = _minOut;
+}
+
+void AnalogInput::begin()
 {
+  int index = (_channels[0] == nullptr) ? 0 : 1;
+  if (_channels[index] != nullptr)
+  {
+    LOG("AnalogInput: no free ADC for pin %d\n", _pin);
+    return;
+  }
+  _channels[index] = this;
+  _module = (index == 0) ? _adc.adc0 : _adc.adc1;
+
   pinMode(_pin, INPUT);
-  // Initialize state with current reading to avoid immediate jump on boot
-  _lastStableRaw = analogRead(_pin);
-  _currentMapped = map(_lastStableRaw, 0, 1023, _minOut, _maxOut);
+  _module->setResolution(12);
+  _module->setAveraging(32);
+  _module->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_LOW_SPEED);
+  _module->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_LOW_SPEED);
+  _module->enableInterrupts((index == 0) ? onSampleAdc0 : onSampleAdc1, ADC_IRQ_PRIORITY);
+  _module->startContinuous(_pin);
+
+  // Initialize state with the first reading to avoid an immediate jump on boot
+  uint32_t start = millis();
+  while (!_primed && millis() - start < 50)
+    yield();
+  _lastStableRaw = _filtered >> 8;
+  _lastMoveTime = millis();
+  _currentMapped = _map(_lastStableRaw);
 }
 
-bool AnalogInput::update()
+// -------------------------------------------------------------------------
+// SAMPLING (ADC ISR)
+// -------------------------------------------------------------------------
+void AnalogInput::onSampleAdc0()
 {
-  int currentRaw = analogRead(_pin);
+  if (_channels[0])
+    _channels[0]->_handleSample();
+}
 
-  // HYSTERESIS CHECK
-  // We only update if the pot has moved significantly (more than noise threshold)
-  if (abs(currentRaw - _lastStableRaw) > _threshold)
-  {
+void AnalogInput::onSampleAdc1()
+{
+  if (_channels[1])
+    _channels[1]->_handleSample();
+}
 
-    // Update the stable raw value
-    _lastStableRaw = currentRaw;
+void AnalogInput::_handleSample()
+{
+  // Reading the result also clears the interrupt
+  _accum += (uint16_t)_module->analogReadContinuous();
+  if (++_accumCount < ADC_DECIMATION)
+    return;
 
-    // Re-calculate the mapped output
-    int newMapped = map(currentRaw, 0, 1023, _minOut, _maxOut);
+  uint32_t sample = _accum << 8;
+  _accum = 0;
+  _accumCount = 0;
 
-    // Only return true if the MAPPED value actually changed
-    // (Prevents true return if noise was high but map bucket was same)
-    if (newMapped != _currentMapped)
-    {
-      _currentMapped = newMapped;
-      return true;
-    }
+  if (!_primed)
+  {
+    _filtered = sample;
+    _primed = true;
+    return;
   }
 
-  return false;
+  // y += (x - y) / 2^shift, in signed fixed point
+  int32_t delta = (int32_t)sample - (int32_t)_filtered;
+  _filtered = (uint32_t)((int32_t)_filtered + (delta >> ADC_IIR_SHIFT));
+}
+
+// -------------------------------------------------------------------------
+// READING (main loop)
+// -------------------------------------------------------------------------
+bool AnalogInput::update()
+{
+  int currentRaw = _filtered >> 8; // Single aligned load, no lock needed
+
+  // ADAPTIVE HYSTERESIS
+  // The band widens linearly from MIN to MAX over POT_BAND_SETTLE_MS of rest
+  uint32_t rest = millis() - _lastMoveTime;
+  if (rest > POT_BAND_SETTLE_MS)
+    rest = POT_BAND_SETTLE_MS;
+  int band = POT_BAND_MIN + (int)((POT_BAND_MAX - POT_BAND_MIN) * rest / POT_BAND_SETTLE_MS);
+
+  if (abs(currentRaw - _lastStableRaw) <= band)
+    return false;
+
+  _lastStableRaw = currentRaw;
+  _lastMoveTime = millis();
+
+  // Only return true if the MAPPED value actually changed
+  // (Prevents true return if noise was high but map bucket was same)
+  int newMapped = _map(currentRaw);
+  if (newMapped == _currentMapped)
+    return false;
+  _currentMapped = newMapped;
+  return true;
+}
+
+// Rounds to nearest, for either direction of range
+int AnalogInput::_map(int raw) const
+{
+  int32_t scaled = (int32_t)raw * (_maxOut - _minOut);
+  scaled += (scaled < 0) ? -(SAMPLE_MAX / 2) : (SAMPLE_MAX / 2);
+  return _minOut + scaled / SAMPLE_MAX;
 }
 
 int AnalogInput::getValue() const
@@ -44,4 +131,4 @@ int AnalogInput::getValue() const
 int AnalogInput::getRaw() const
 {
   return _lastStableRaw;
-}
\ No newline at end of file
+}
@@ -1,11 +1,22 @@
 #pragma once
 #include <Arduino.h>
+#include <ADC.h>
+#include "Config.h"
 
+// A pot sampled in the background by one of the two ADCs (see POT
+// SAMPLING in Config.h). The ADC interrupt does the oversampling and the
+// filtering; update() only applies hysteresis to the latest value, so it
+// costs the same no matter how noisy the pot is.
 class AnalogInput
 {
 public:
-  // threshold: Raw ADC variance required to trigger an update (default 8)
-  AnalogInput(int pin, int minOut, int maxOut, int threshold = 8);
+  // minOut/maxOut: output range (may be reversed). Use a scaled range for
+  // sub-unit resolution, e.g. 3000 - 30000 for centiBPM.
+  AnalogInput(int pin, int minOut, int maxOut);
+
+  // Claims the next free ADC and starts continuous conversion.
+  // Blocks until the first filtered sample is in (a few ms).
+  void begin();
 
   // Call this in your main loop or processInput
   // Returns true if the value has changed significantly
@@ -14,15 +25,32 @@ public:
   // Returns the current smoothed/mapped value
   int getValue() const;
 
-  // Returns the raw ADC reading (useful for debugging)
+  // Returns the 16-bit filtered value at the last update (useful for debugging)
   int getRaw() const;
 
+  static void onSampleAdc0();
+  static void onSampleAdc1();
+
 private:
+  static ADC _adc;
+  static AnalogInput *_channels[2];
+
   int _pin;
   int _minOut;
   int _maxOut;
-  int _threshold;
+  ADC_Module *_module;
+
+  // SAMPLE STATE (ADC ISR)
+  uint32_t _accum;             // Sum of the current decimation block
+  uint8_t _accumCount;
+  volatile uint32_t _filtered; // 16-bit sample, 8 fraction bits
+  volatile bool _primed;       // At least one sample has landed
+
+  // HYSTERESIS STATE (main loop)
+  int _lastStableRaw;      // The 16-bit value at the last confirmed update
+  uint32_t _lastMoveTime;  // millis() of that update
+  int _currentMapped;      // The calculated output value
 
-  int _lastStableRaw; // The raw value at the last confirmed update
-  int _currentMapped; // The calculate output value
-};
\ No newline at end of file
+  void _handleSample();
+  int _map(int raw) const;
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <Arduino.h>
+#include "InputCommands.h"
+#include "KeyMatrix.h"
+
+// Physical inputs -> InputCommand, as data. Remap a key by editing the
+// lists below; the lookup tables are generated from them at compile time,
+// so resolving an input is one array load whatever the list length.
+
+#define NUM_SWITCHES (MATRIX_ROWS * MATRIX_COLS)
+
+// When a binding applies
+enum BindWhen : uint8_t
+{
+  BIND_ANY,
+  BIND_OFF,
+  BIND_ON,
+};
+
+// ---- MATRIX ----
+// Keyed on the switch ID, the Shift state captured with the event and
+// whether the model is in song mode. Later entries override earlier ones,
+// so list the plain binding first and the modified ones after it.
+struct MatrixBinding
+{
+  uint8_t firstID; // Switch IDs, inclusive range
+  uint8_t lastID;
+  BindWhen shift;
+  BindWhen song;
+  InputCommand cmd; // Runs of IDs map onto consecutive commands
+};
+
+constexpr MatrixBinding MATRIX_BINDINGS[] = {
+    // Rows 1 & 2: Steps 1-16
+    {1, 16, BIND_ANY, BIND_ANY, CMD_TRIGGER_1},
+    {1, 4, BIND_ON, BIND_ANY, CMD_PLAYLIST_BANK_1},
+
+    // Row 3: Tracks A-H
+    {17, 24, BIND_ANY, BIND_ANY, CMD_TRACK_1},
+    {23, 23, BIND_ON, BIND_ANY, CMD_REDO}, // Shift + G
+    {24, 24, BIND_ON, BIND_ANY, CMD_UNDO}, // Shift + H
+
+    // Row 4: Function keys
+    {25, 25, BIND_ANY, BIND_ANY, CMD_CLEAR_PROMPT},
+    {25, 25, BIND_ANY, BIND_ON, CMD_PLAYLIST_DELETE},
+    {26, 26, BIND_ANY, BIND_ANY, CMD_TRACK_PREV},
+    {27, 27, BIND_ANY, BIND_ANY, CMD_TRACK_NEXT},
+    {28, 28, BIND_ANY, BIND_ANY, CMD_PATTERN_PREV},
+    {28, 28, BIND_ANY, BIND_ON, CMD_PLAYLIST_PREV},
+    {28, 28, BIND_ON, BIND_ON, CMD_PLAYLIST_INSERT_PREV},
+    {29, 29, BIND_ANY, BIND_ANY, CMD_PATTERN_NEXT},
+    {29, 29, BIND_ANY, BIND_ON, CMD_PLAYLIST_NEXT},
+    {29, 29, BIND_ON, BIND_ON, CMD_PLAYLIST_INSERT_NEXT},
+    {30, 30, BIND_ANY, BIND_ANY, CMD_TRANSPORT_TOGGLE}, // PLAY
+    {30, 30, BIND_ON, BIND_ANY, CMD_QUANTIZE_MENU},
+    {31, 31, BIND_ANY, BIND_ANY, CMD_SONG_MODE_TOGGLE},
+    {31, 31, BIND_ON, BIND_ANY, CMD_MODE_TOGGLE},
+    // 32 is Shift itself
+};
+
+// [song][shift][switchID], ID 0 unused
+struct MatrixMap
+{
+  uint8_t cmd[2][2][NUM_SWITCHES + 1];
+
+  InputCommand lookup(bool song, bool shift, uint8_t id) const
+  {
+    return (id <= NUM_SWITCHES) ? (InputCommand)cmd[song][shift][id] : CMD_NONE;
+  }
+};
+
+constexpr bool bindMatches(BindWhen when, bool state)
+{
+  return when == BIND_ANY || (when == BIND_ON) == state;
+}
+
+constexpr MatrixMap buildMatrixMap()
+{
+  MatrixMap map{};
+  for (const MatrixBinding &b : MATRIX_BINDINGS)
+    for (int song = 0; song < 2; song++)
+      for (int shift = 0; shift < 2; shift++)
+      {
+        if (!bindMatches(b.song, song) || !bindMatches(b.shift, shift))
+          continue;
+        for (int id = b.firstID; id <= b.lastID; id++)
+          map.cmd[song][shift][id] = b.cmd + (id - b.firstID);
+      }
+  return map;
+}
+
+// ---- USB KEYBOARD ----
+// Keyed on the HID usage ID of the key (boot protocol scancode), so the
+// layout set on the host does not matter
+struct KeyBinding
+{
+  uint8_t firstKey; // HID usage IDs, inclusive range
+  uint8_t lastKey;
+  InputCommand cmd; // Runs of keys map onto consecutive commands
+};
+
+constexpr KeyBinding KEY_BINDINGS[] = {
+    {0x2C, 0x2C, CMD_TRANSPORT_TOGGLE}, // Space
+    {0x2B, 0x2B, CMD_MODE_TOGGLE},      // Tab
+    {0x28, 0x28, CMD_SONG_MODE_TOGGLE}, // Enter
+    {0x58, 0x58, CMD_SONG_MODE_TOGGLE}, // Keypad Enter
+    {0x1D, 0x1D, CMD_UNDO},             // Z
+    {0x1C, 0x1C, CMD_REDO},             // Y
+    {0x14, 0x14, CMD_QUANTIZE_MENU},    // Q
+    {0x0E, 0x0E, CMD_CLOCK_SOURCE},     // K
+    {0x17, 0x17, CMD_BPM_ENTER},        // T
+    {0x1A, 0x1A, CMD_GATE_WIDTH_ENTER}, // W
+    {0x11, 0x11, CMD_MIDI_NOTE_ENTER},  // N
+    {0x10, 0x10, CMD_MIDI_CHANNEL_ENTER}, // M
+    {0x29, 0x29, CMD_CONFIRM_NO},       // Esc
+    {0x2A, 0x2A, CMD_INPUT_DELETE},     // Backspace
+
+    // Track Direct Selection (A-H)
+    {0x04, 0x0B, CMD_TRACK_1},
+
+    // Navigation
+    {0x2F, 0x2F, CMD_PATTERN_PREV}, // [
+    {0x30, 0x30, CMD_PATTERN_NEXT}, // ]
+
+    // Triggers: number row 1-9, 0
+    {0x1E, 0x27, CMD_TRIGGER_1},
+};
+
+struct KeyMap
+{
+  uint8_t cmd[128]; // Usage IDs above 0x7F are never bound
+
+  InputCommand lookup(uint8_t key) const
+  {
+    return (key < 128) ? (InputCommand)cmd[key] : CMD_NONE;
+  }
+};
+
+constexpr KeyMap buildKeyMap()
+{
+  KeyMap map{};
+  for (const KeyBinding &b : KEY_BINDINGS)
+    for (int key = b.firstKey; key <= b.lastKey; key++)
+      map.cmd[key] = b.cmd + (key - b.firstKey);
+  return map;
+}
@@ -10,7 +10,12 @@ enum InputCommand
   CMD_SONG_MODE_TOGGLE,
   CMD_TEST_TOGGLE,
   CMD_BPM_ENTER,
+  CMD_GATE_WIDTH_ENTER, // Active track
+  CMD_MIDI_NOTE_ENTER,  // Active track
+  CMD_MIDI_CHANNEL_ENTER,
   CMD_UNDO,
+  CMD_REDO,
+  CMD_CLOCK_SOURCE, // Internal -> MIDI in -> pulse in
 
   CMD_QUANTIZE_MENU,
 
@@ -65,5 +70,10 @@ enum InputCommand
   // CONFIRMATION MODALS
   CMD_CLEAR_PROMPT,
   CMD_CONFIRM_YES,
-  CMD_CONFIRM_NO
+  CMD_CONFIRM_NO,
+
+  // NUMBER ENTRY (digits come in as CMD_TRIGGER_1-10)
+  CMD_INPUT_DELETE,
+
+  NUM_COMMANDS
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "KeyMatrix.h"
+#include "Profiler.h"
 
 // LUT: Maps [Row][Col] to Switch Number (1-32)
 const int SWITCH_MAP[4][8] = {
@@ -9,11 +10,27 @@ const int SWITCH_MAP[4][8] = {
     {18, 20, 22, 24, 26, 28, 30, 32}  // Row 4 (Pin 40) -> Even Functions
 };
 
+// Each key is sampled once per full pass over the rows
+#define SCAN_PERIOD_US (KEY_SCAN_ROW_US * MATRIX_ROWS)
+#define HOLD_SCANS (KEY_HOLD_MS * 1000UL / SCAN_PERIOD_US)
+#define REPEAT_SCANS (KEY_REPEAT_MS * 1000UL / SCAN_PERIOD_US)
+
+KeyMatrix *KeyMatrix::_instance = nullptr;
+
 KeyMatrix::KeyMatrix()
 {
-  _lastScanTime = 0;
-  _head = 0;
-  _tail = 0;
+  _instance = this;
+  _scanRow = 0;
+  for (int r = 0; r < MATRIX_ROWS; r++)
+  {
+    _stableRows[r] = 0;
+    for (int c = 0; c < MATRIX_COLS; c++)
+    {
+      _integrator[r][c] = 0;
+      _edgeStart[r][c] = 0;
+      _heldScans[r][c] = 0;
+    }
+  }
 }
 
 void KeyMatrix::init()
@@ -30,77 +47,113 @@ void KeyMatrix::init()
     pinMode(_rowPins[i], INPUT);
   }
 
-  // Clear state
-  for (int r = 0; r < MATRIX_ROWS; r++)
-  {
-    for (int c = 0; c < MATRIX_COLS; c++)
-    {
-      _state[r][c] = false;
-      _lastState[r][c] = false;
-    }
-  }
+  // Activate the first row; the first interrupt reads it
+  _scanRow = 0;
+  pinMode(_rowPins[0], OUTPUT);
+  digitalWrite(_rowPins[0], LOW);
+
+  _timer.priority(KEY_SCAN_IRQ_PRIORITY);
+  _timer.begin(onScan, KEY_SCAN_ROW_US);
 }
 
-void KeyMatrix::update()
+void KeyMatrix::onScan()
 {
-  // THROTTLE: Scan at ~200Hz (5ms) to handle debounce naturally
-  if (millis() - _lastScanTime < 5)
-    return;
-  _lastScanTime = millis();
+  if (_instance)
+    _instance->_handleScan();
+}
 
-  // SCAN LOOP
-  for (int r = 0; r < MATRIX_ROWS; r++)
+// -------------------------------------------------------------------------
+// ISR: ONE ROW PER INTERRUPT
+// -------------------------------------------------------------------------
+// The row being read was driven at the previous interrupt, so it has had a
+// whole period to settle and no busy-wait is needed.
+void KeyMatrix::_handleScan()
+{
+  PROFILE_BEGIN(PROF_KEY_SCAN);
+  int r = _scanRow;
+  uint8_t stable = _stableRows[r];
+  uint32_t now = micros();
+
+  // Read Cols
+  for (int c = 0; c < MATRIX_COLS; c++)
   {
-    // Activate Row (Drive Low)
-    pinMode(_rowPins[r], OUTPUT);
-    digitalWrite(_rowPins[r], LOW);
-    delayMicroseconds(10); // Settle time
+    bool isPressed = (digitalRead(_colPins[c]) == LOW);
 
-    // Read Cols
-    for (int c = 0; c < MATRIX_COLS; c++)
+    // INTEGRATING DEBOUNCE
+    // Leaving a rail marks when the contact started to change
+    uint8_t &level = _integrator[r][c];
+    if (isPressed && level < KEY_DEBOUNCE_SAMPLES)
+    {
+      if (level == 0)
+        _edgeStart[r][c] = now;
+      level++;
+    }
+    else if (!isPressed && level > 0)
     {
-      bool isPressed = (digitalRead(_colPins[c]) == LOW);
+      if (level == KEY_DEBOUNCE_SAMPLES)
+        _edgeStart[r][c] = now;
+      level--;
+    }
 
-      // DETECT RISING EDGE (Just Pressed)
-      if (isPressed && !_lastState[r][c])
-      {
-        _state[r][c] = true;
-
-        // PUSH TO RING BUFFER
-        int nextHead = (_head + 1) % EVENT_BUFFER_SIZE;
-        if (nextHead != _tail)
-        { // Prevent overflow overwriting
-          _eventBuffer[_head] = SWITCH_MAP[r][c];
-          _head = nextHead;
-        }
-      }
-      // DETECT FALLING EDGE (Released)
-      else if (!isPressed && _lastState[r][c])
+    bool wasDown = (stable >> c) & 1;
+
+    // DETECT RISING EDGE (Just Pressed)
+    if (!wasDown && level == KEY_DEBOUNCE_SAMPLES)
+    {
+      stable |= (1 << c);
+      _heldScans[r][c] = 0;
+      _pushEvent(r, c, KEY_PRESS, _edgeStart[r][c]);
+    }
+    // DETECT FALLING EDGE (Released)
+    else if (wasDown && level == 0)
+    {
+      stable &= ~(1 << c);
+      _pushEvent(r, c, KEY_RELEASE, _edgeStart[r][c]);
+    }
+    // HOLD / REPEAT
+    else if (wasDown)
+    {
+      uint16_t &held = _heldScans[r][c];
+      held++;
+      if (held == HOLD_SCANS)
+        _pushEvent(r, c, KEY_HOLD, now);
+      else if (held == HOLD_SCANS + REPEAT_SCANS)
       {
-        _state[r][c] = false;
+        _pushEvent(r, c, KEY_REPEAT, now);
+        held = HOLD_SCANS; // Count the next repeat from here
       }
-
-      _lastState[r][c] = isPressed;
     }
-
-    // Deactivate Row (Float)
-    pinMode(_rowPins[r], INPUT);
   }
+  _stableRows[r] = stable;
+
+  // Deactivate Row (Float), then drive the next one for the next interrupt
+  pinMode(_rowPins[r], INPUT);
+  _scanRow = (r + 1 < MATRIX_ROWS) ? r + 1 : 0;
+  pinMode(_rowPins[_scanRow], OUTPUT);
+  digitalWrite(_rowPins[_scanRow], LOW);
+  PROFILE_END(PROF_KEY_SCAN);
 }
 
-int KeyMatrix::getNextEvent()
+// A full queue drops the event rather than blocking the ISR
+void KeyMatrix::_pushEvent(int r, int c, KeyEventType type, uint32_t time)
 {
-  // Return 0 if buffer is empty
-  if (_head == _tail)
-    return 0;
+  KeyEvent event;
+  event.time = time;
+  event.switchID = SWITCH_MAP[r][c];
+  event.type = type;
+  // Debounced state before this scan, so a modifier pressed in the same
+  // instant as the key does not count
+  event.modifiers = isShiftHeld() ? MOD_SHIFT : 0;
+  _events.push(event);
+}
 
-  int id = _eventBuffer[_tail];
-  _tail = (_tail + 1) % EVENT_BUFFER_SIZE;
-  return id;
+bool KeyMatrix::getNextEvent(KeyEvent &event)
+{
+  return _events.pop(event);
 }
 
-bool KeyMatrix::isShiftHeld()
+bool KeyMatrix::isShiftHeld() const
 {
   // Switch 32 is Row 3 (Index 3), Col 7
-  return _state[3][7];
-}
\ No newline at end of file
+  return (_stableRows[3] >> 7) & 1;
+}
@@ -1,44 +1,75 @@
 #pragma once
 #include <Arduino.h>
 #include "Config.h"
+#include "GptTimer.h"
+#include "SpscQueue.h"
 
 // 4 Rows, 8 Columns
 #define MATRIX_ROWS 4
 #define MATRIX_COLS 8
 
-// Buffer size for simultaneous keypresses
-#define EVENT_BUFFER_SIZE 16
+enum KeyEventType
+{
+  KEY_PRESS,
+  KEY_RELEASE,
+  KEY_HOLD,   // Still down after KEY_HOLD_MS
+  KEY_REPEAT, // Every KEY_REPEAT_MS after the hold
+};
+
+// Modifier keys held when the event happened
+enum KeyModifiers
+{
+  MOD_SHIFT = 0x01, // Switch 32
+};
+
+// A debounced key event. Press and release are stamped with the first
+// sample of the contact change (before debouncing), hold and repeat with
+// the scan that produced them.
+struct KeyEvent
+{
+  uint32_t time;     // micros()
+  uint8_t switchID;  // 1-32, see SWITCH_MAP (UsbKeyboard: HID usage ID)
+  uint8_t type;      // KeyEventType
+  uint8_t modifiers; // KeyModifiers snapshot
+};
 
+// Scanned from a timer ISR, one row per interrupt, below the clock's
+// priority. The main loop only drains the event queue, so a blocked loop()
+// delays handling but never loses or mis-times a press.
 class KeyMatrix
 {
 public:
   KeyMatrix();
-  void init();
-
-  // Scans the hardware and fills the internal buffer
-  // Call this once per main loop / processInput
-  void update();
+  void init(); // Starts the scan timer
 
   // Pops the next event from the queue.
-  // Returns 0 if empty.
-  int getNextEvent();
+  // Returns false if empty.
+  bool getNextEvent(KeyEvent &event);
 
-  // Check if a specific modifier key is currently held down
-  bool isShiftHeld();
+  // Check if a specific modifier key is currently held down.
+  // Live state: key events carry their own snapshot in KeyEvent::modifiers.
+  bool isShiftHeld() const;
+
+  static void onScan();
 
 private:
+  static KeyMatrix *_instance;
+  GptTimer _timer; // Own interrupt, below the clock's PIT
+
   int _rowPins[MATRIX_ROWS] = {PIN_ROW_1, PIN_ROW_2, PIN_ROW_3, PIN_ROW_4};
   int _colPins[MATRIX_COLS] = {PIN_COL_1, PIN_COL_2, PIN_COL_3, PIN_COL_4,
                                PIN_COL_5, PIN_COL_6, PIN_COL_7, PIN_COL_8};
 
-  // State
-  bool _state[MATRIX_ROWS][MATRIX_COLS];
-  bool _lastState[MATRIX_ROWS][MATRIX_COLS];
+  // SCAN STATE (ISR)
+  uint8_t _scanRow;                                // Row currently driven low
+  uint8_t _integrator[MATRIX_ROWS][MATRIX_COLS];   // 0 - KEY_DEBOUNCE_SAMPLES
+  uint32_t _edgeStart[MATRIX_ROWS][MATRIX_COLS];   // First sample of the current change
+  uint16_t _heldScans[MATRIX_ROWS][MATRIX_COLS];   // Scans since press (hold/repeat)
+  volatile uint8_t _stableRows[MATRIX_ROWS];       // Debounced state, bit c = col c
 
-  unsigned long _lastScanTime;
+  // ISR -> loop()
+  SpscQueue<KeyEvent, KEY_EVENT_QUEUE_SIZE> _events;
 
-  // RING BUFFER
-  int _eventBuffer[EVENT_BUFFER_SIZE];
-  int _head; // Write index
-  int _tail; // Read index
-};
\ No newline at end of file
+  void _handleScan();
+  void _pushEvent(int r, int c, KeyEventType type, uint32_t time);
+};
@@ -1,25 +1,28 @@
 #include "UIManager.h"
 #include "Debug.h"
+#include "Profiler.h"
+#include "Bindings.h"
 
-// MACROS
-#define ASCII_BS 8
-#define ASCII_TAB 9
-#define ASCII_LF 10
-#define ASCII_CR 13
-#define ASCII_ESC 27
-#define ASCII_SPACE 32
-#define ASCII_DEL 127
+// Typed BPM values outside this range are ignored; gate widths, notes
+// and channels are clamped to their range
+#define BPM_INPUT_MIN 30
+#define BPM_INPUT_MAX 300
 
 UIManager::UIManager(SequencerModel &model, OutputDriver &driver, ClockEngine &clock)
     : _model(model),
       _driver(driver),
       _clock(clock),
-      _tempoPot(PIN_POT_TEMPO, POT_INVERT_POLARITY ? 300 : 30, POT_INVERT_POLARITY ? 30 : 300, 4),
-      _paramPot(PIN_POT_PARAM, POT_INVERT_POLARITY ? 63 : 0, POT_INVERT_POLARITY ? 0 : 63, 2)
+      _tempoPot(PIN_POT_TEMPO, POT_INVERT_POLARITY ? 30000 : 3000, POT_INVERT_POLARITY ? 3000 : 30000), // centiBPM
+      _paramPot(PIN_POT_PARAM, POT_INVERT_POLARITY ? 63 : 0, POT_INVERT_POLARITY ? 0 : 63)
 {
   _currentMode = UI_MODE_STEP_EDIT;
+  _version = 0;
+  _commandTime = 0;
   _uiSelectedSlot = 0;
   _songModeBankOffset = 0;
+  _inputPtr = 0;
+  memset(_inputBuffer, 0, sizeof(_inputBuffer));
+  _inputTarget = INPUT_BPM;
   _lastSwingChangeTime = 0;
   _lastSwingValue = 0;
 }
@@ -27,19 +30,29 @@ UIManager::UIManager(SequencerModel &model, OutputDriver &driver, ClockEngine &c
 void UIManager::init()
 {
   _keyMatrix.init();
+  _tempoPot.begin();
+  _paramPot.begin();
 }
 
 void UIManager::processInput()
 {
+  // Playlist edits are applied by the engine, so clamp against what
+  // actually landed rather than guessing at the call site
+  if (_uiSelectedSlot >= _model.getPlaylistLength())
+  {
+    _uiSelectedSlot = max(0, _model.getPlaylistLength() - 1);
+    _version++;
+  }
+
   // 1. ANALOG
   if (_tempoPot.update())
   {
-    _model.setBPM(_tempoPot.getValue());
+    _model.setCentiBPM(_tempoPot.getValue());
   }
 
   if (_paramPot.update())
   {
-    bool shift = _keyMatrix.isShiftHeld();
+    bool shift = _keyMatrix.isShiftHeld() || _usbKeyboard.isShiftHeld();
 
     // CASE A: SWING CONTROL (Shift + Param)
     if (shift)
@@ -48,6 +61,7 @@ void UIManager::processInput()
       _model.setTrackSwing(_model.activeTrackID, swingVal);
       _lastSwingValue = swingVal;
       _lastSwingChangeTime = millis();
+      _version++;
       LOG("Track %d Swing: %d\n", _model.activeTrackID, swingVal);
     }
     // CASE B: SONG MODE Pattern Select (No Shift)
@@ -67,15 +81,46 @@ void UIManager::processInput()
     }
   }
 
-  // 2. MATRIX SCAN
-  _keyMatrix.update();
+  // 2. MATRIX EVENTS (scanned and debounced by the matrix timer)
+  KeyEvent event;
+  while (_keyMatrix.getNextEvent(event))
+  {
+    LOG("Matrix Event: Switch %d type %d mods %d (%lu us ago)\n", event.switchID, event.type,
+        event.modifiers, (unsigned long)(micros() - event.time));
+
+    // Presses drive commands; held navigation keys auto-repeat
+    if (event.type != KEY_PRESS && event.type != KEY_REPEAT)
+      continue;
+
+    InputCommand cmd = _mapMatrixToCommand(event);
+    if (event.type == KEY_REPEAT && !_isRepeatable(cmd))
+      continue;
+
+    if (cmd != CMD_NONE)
+    {
+      _commandTime = event.time;
+      handleCommand(cmd);
+    }
+  }
 
-  while (int swID = _keyMatrix.getNextEvent())
+  // 3. USB KEYBOARD EVENTS (raw reports, queued by the USB host driver)
+  while (_usbKeyboard.getNextEvent(event))
   {
-    LOG("Matrix Event: Switch %d\n", swID);
-    InputCommand cmd = _mapMatrixToCommand(swID);
+    LOG("USB Key: 0x%02X type %d mods %d (%lu us ago)\n", event.switchID, event.type,
+        event.modifiers, (unsigned long)(micros() - event.time));
+
+    // Releases only end the keyboard's auto-repeat, inside UsbKeyboard.
+    // Held navigation keys repeat as on the matrix.
+    if (event.type != KEY_PRESS && event.type != KEY_REPEAT)
+      continue;
+
+    InputCommand cmd = _mapKeyToCommand(event);
+    if (event.type == KEY_REPEAT && !_isRepeatable(cmd))
+      continue;
+
     if (cmd != CMD_NONE)
     {
+      _commandTime = event.time;
       handleCommand(cmd);
     }
   }
@@ -84,548 +129,366 @@ void UIManager::processInput()
 // ----------------------------------------------------------------------
 // MAPPER
 // ----------------------------------------------------------------------
-InputCommand UIManager::_mapMatrixToCommand(int id)
+static constexpr MatrixMap MATRIX_MAP = buildMatrixMap();
+static constexpr KeyMap KEY_MAP = buildKeyMap();
+
+InputCommand UIManager::_mapMatrixToCommand(const KeyEvent &event)
 {
-  bool shift = _keyMatrix.isShiftHeld();
+  // Shift as it was when the key went down, not when the queue is drained
+  bool shift = event.modifiers & MOD_SHIFT;
+  return MATRIX_MAP.lookup(_model.getPlayMode() == MODE_SONG, shift, event.switchID);
+}
 
-  // ROW 1 & 2 (Physical): Steps 1-16
-  if (id >= 1 && id <= 16)
-  {
-    if (shift && id <= 4)
-    {
-      switch (id)
-      {
-      case 1:
-        return CMD_PLAYLIST_BANK_1;
-      case 2:
-        return CMD_PLAYLIST_BANK_2;
-      case 3:
-        return CMD_PLAYLIST_BANK_3;
-      case 4:
-        return CMD_PLAYLIST_BANK_4;
-      default:
-        return CMD_NONE;
-      }
-    }
-    return (InputCommand)(CMD_TRIGGER_1 + (id - 1));
-  }
+InputCommand UIManager::_mapKeyToCommand(const KeyEvent &event)
+{
+  return KEY_MAP.lookup(event.switchID);
+}
 
-  // FUNCTION KEYS
-  switch (id)
+bool UIManager::_isRepeatable(InputCommand cmd)
+{
+  switch (cmd)
   {
-  case 17:
-    return CMD_TRACK_1;
-  case 18:
-    return CMD_TRACK_2;
-  case 19:
-    return CMD_TRACK_3;
-  case 20:
-    return CMD_TRACK_4;
-
-  // NEW: Map physical buttons E, F, G (IDs 21-23)
-  case 21:
-    return CMD_TRACK_5;
-  case 22:
-    return CMD_TRACK_6;
-  case 23:
-    return CMD_TRACK_7;
-
-  // NEW: Map physical button H (ID 24)
-  case 24:
-    if (shift)
-      return CMD_UNDO;  // Shift + H = UNDO
-    return CMD_TRACK_8; // H = Track 8
-
-  case 25:
-    if (_model.getPlayMode() == MODE_SONG)
-      return CMD_PLAYLIST_DELETE;
-    return CMD_CLEAR_PROMPT;
-
-  case 26:
-    return CMD_TRACK_PREV;
-  case 27:
-    return CMD_TRACK_NEXT;
-
-  case 28:
-    if (shift && _model.getPlayMode() == MODE_SONG)
-      return CMD_PLAYLIST_INSERT_PREV;
-    if (_model.getPlayMode() == MODE_SONG)
-      return CMD_PLAYLIST_PREV;
-    return CMD_PATTERN_PREV;
-
-  case 29:
-    if (shift && _model.getPlayMode() == MODE_SONG)
-      return CMD_PLAYLIST_INSERT_NEXT;
-    if (_model.getPlayMode() == MODE_SONG)
-      return CMD_PLAYLIST_NEXT;
-    return CMD_PATTERN_NEXT;
-
-  case 30: // PLAY
-    if (shift)
-      return CMD_QUANTIZE_MENU;
-    return CMD_TRANSPORT_TOGGLE;
-
-  case 31:
-    if (shift)
-      return CMD_MODE_TOGGLE;
-    return CMD_SONG_MODE_TOGGLE;
-
-  case 32:
-    return CMD_NONE;
-
+  case CMD_PATTERN_PREV:
+  case CMD_PATTERN_NEXT:
+  case CMD_TRACK_PREV:
+  case CMD_TRACK_NEXT:
+  case CMD_PLAYLIST_PREV:
+  case CMD_PLAYLIST_NEXT:
+    return true;
   default:
-    return CMD_NONE;
+    return false;
   }
 }
 
 // ----------------------------------------------------------------------
-// TRANSLATOR
+// EXECUTOR
 // ----------------------------------------------------------------------
-void UIManager::handleKeyPress(int key)
-{
-  InputCommand cmd = CMD_NONE;
-
-  if (key == ASCII_SPACE)
-    cmd = CMD_TRANSPORT_TOGGLE;
-  else if (key == ASCII_TAB)
-    cmd = CMD_MODE_TOGGLE;
-  else if (key == ASCII_CR || key == ASCII_LF)
-    cmd = CMD_SONG_MODE_TOGGLE;
-  else if (key == 'z')
-    cmd = CMD_UNDO;
-  else if (key == 'q')
-    cmd = CMD_QUANTIZE_MENU;
-
-  // Track Direct Selection (A-H)
-  else if (key == 'a')
-    cmd = CMD_TRACK_1;
-  else if (key == 'b')
-    cmd = CMD_TRACK_2;
-  else if (key == 'c')
-    cmd = CMD_TRACK_3;
-  else if (key == 'd')
-    cmd = CMD_TRACK_4;
-  else if (key == 'e')
-    cmd = CMD_TRACK_5;
-  else if (key == 'f')
-    cmd = CMD_TRACK_6;
-  else if (key == 'g')
-    cmd = CMD_TRACK_7;
-  else if (key == 'h')
-    cmd = CMD_TRACK_8;
-
-  // Navigation
-  else if (key == '[')
-    cmd = CMD_PATTERN_PREV;
-  else if (key == ']')
-    cmd = CMD_PATTERN_NEXT;
-
-  // Triggers
-  else if (key >= '1' && key <= '4')
-    cmd = (InputCommand)(CMD_TRIGGER_1 + (key - '1'));
-
-  if (cmd != CMD_NONE)
-    handleCommand(cmd);
+// What a command does depends on where the UI is. Each context gets a
+// full row of the command table, generated below from a list of rules.
+UIManager::CommandContext UIManager::_getContext() const
+{
+  // --- PRIORITY 1: MODAL HANDLING (MENUS) ---
+  if (_currentMode == UI_MODE_QUANTIZE_MENU)
+    return CTX_QUANTIZE_MENU;
+  if (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK ||
+      _currentMode == UI_MODE_CONFIRM_CLEAR_PATTERN)
+    return CTX_CONFIRM_CLEAR;
+  if (_currentMode == UI_MODE_NUMBER_INPUT)
+    return CTX_NUMBER_INPUT;
+
+  // --- PRIORITY 2: CONTEXT SPECIFIC ---
+  return (_model.getPlayMode() == MODE_SONG) ? CTX_SONG : CTX_PATTERN;
 }
 
-// ----------------------------------------------------------------------
-// EXECUTOR
-// ----------------------------------------------------------------------
 void UIManager::handleCommand(InputCommand cmd)
 {
-  // --- PRIORITY 1: HARDWARE TEST ---
-  if (cmd == CMD_TEST_TOGGLE)
-  {
-    if (_model.getPlayMode() == MODE_HARDWARE_TEST)
-    {
-      _model.setPlayMode(MODE_PATTERN_LOOP);
-      _model.stop();
-    }
-    else
-    {
-      _model.setPlayMode(MODE_HARDWARE_TEST);
-    }
+  if (cmd <= CMD_NONE || cmd >= NUM_COMMANDS)
     return;
-  }
 
-  // --- PRIORITY 2: MODAL HANDLING (MENUS) ---
+  // Nearly every command changes something on screen. Commands are rare,
+  // so a spurious redraw is cheaper than tracking each case.
+  _version++;
+
+  // Against the if/else ladders this replaced (test_bindings), the table
+  // costs about the same per event: a context lookup and one indirect
+  // call in place of a few well-predicted branches. What it buys is one
+  // place to read and change what a command does in every context.
+  PROFILE_BEGIN(PROF_UI_DISPATCH);
+  const CommandRoute &route = _commandTable.routes[_getContext()][cmd];
+  if (route.handler)
+    route.handler(*this, route.arg);
+  PROFILE_END(PROF_UI_DISPATCH);
+}
 
-  // A. QUANTIZE MENU
-  if (_currentMode == UI_MODE_QUANTIZE_MENU)
-  {
-    if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_4)
+// Rules are applied in order, so later rules override earlier ones.
+// A run of commands maps onto args arg, arg + step, arg + 2 * step ...
+constexpr UIManager::CommandTable UIManager::_buildCommandTable()
+{
+  constexpr uint8_t MENUS = (1 << CTX_QUANTIZE_MENU) | (1 << CTX_CONFIRM_CLEAR) | (1 << CTX_NUMBER_INPUT);
+  constexpr uint8_t PLAY = (1 << CTX_SONG) | (1 << CTX_PATTERN);
+  constexpr uint8_t ALL = MENUS | PLAY;
+
+  constexpr CommandRule rules[] = {
+      // A. QUANTIZE MENU: any other command just closes it
+      {1 << CTX_QUANTIZE_MENU, CMD_NONE + 1, NUM_COMMANDS - 1, &_call<&UIManager::_cmdCloseMenu>, 0, 0},
+      {1 << CTX_QUANTIZE_MENU, CMD_TRIGGER_1, CMD_TRIGGER_4, &_call<&UIManager::_cmdSetQuantization>, Q_BAR, 1},
+
+      // B. CLEAR PROMPT
+      {1 << CTX_CONFIRM_CLEAR, CMD_TRIGGER_1, CMD_TRIGGER_4, &_call<&UIManager::_cmdConfirmClear>, 0, 0},
+      {1 << CTX_CONFIRM_CLEAR, CMD_CONFIRM_YES, CMD_CONFIRM_YES, &_call<&UIManager::_cmdConfirmClear>, 0, 0},
+      {1 << CTX_CONFIRM_CLEAR, CMD_SONG_MODE_TOGGLE, CMD_SONG_MODE_TOGGLE, &_call<&UIManager::_cmdConfirmClear>, 0, 0},
+      {1 << CTX_CONFIRM_CLEAR, CMD_TRIGGER_13, CMD_TRIGGER_16, &_call<&UIManager::_cmdCancelClear>, 0, 0},
+      {1 << CTX_CONFIRM_CLEAR, CMD_CONFIRM_NO, CMD_CONFIRM_NO, &_call<&UIManager::_cmdCancelClear>, 0, 0},
+      {1 << CTX_CONFIRM_CLEAR, CMD_CLEAR_PROMPT, CMD_CLEAR_PROMPT, &_call<&UIManager::_cmdCycleClear>, 0, 0},
+
+      // C. NUMBER ENTRY: number row (1-9, 0), Backspace, Enter, Esc; the rest is ignored
+      {1 << CTX_NUMBER_INPUT, CMD_TRIGGER_1, CMD_TRIGGER_9, &_call<&UIManager::_cmdInputDigit>, 1, 1},
+      {1 << CTX_NUMBER_INPUT, CMD_TRIGGER_10, CMD_TRIGGER_10, &_call<&UIManager::_cmdInputDigit>, 0, 0},
+      {1 << CTX_NUMBER_INPUT, CMD_INPUT_DELETE, CMD_INPUT_DELETE, &_call<&UIManager::_cmdInputDelete>, 0, 0},
+      {1 << CTX_NUMBER_INPUT, CMD_CONFIRM_YES, CMD_CONFIRM_YES, &_call<&UIManager::_cmdInputEnter>, 0, 0},
+      {1 << CTX_NUMBER_INPUT, CMD_SONG_MODE_TOGGLE, CMD_SONG_MODE_TOGGLE, &_call<&UIManager::_cmdInputEnter>, 0, 0},
+      {1 << CTX_NUMBER_INPUT, CMD_CONFIRM_NO, CMD_CONFIRM_NO, &_call<&UIManager::_cmdInputCancel>, 0, 0},
+
+      // D. GLOBAL KEYS
+      {PLAY, CMD_TRANSPORT_TOGGLE, CMD_TRANSPORT_TOGGLE, &_call<&UIManager::_cmdTransportToggle>, 0, 0},
+      {PLAY, CMD_QUANTIZE_MENU, CMD_QUANTIZE_MENU, &_call<&UIManager::_cmdOpenQuantizeMenu>, 0, 0},
+      {PLAY, CMD_MODE_TOGGLE, CMD_MODE_TOGGLE, &_call<&UIManager::_cmdModeToggle>, 0, 0},
+      {PLAY, CMD_SONG_MODE_TOGGLE, CMD_SONG_MODE_TOGGLE, &_call<&UIManager::_cmdSongModeToggle>, 0, 0},
+      {PLAY, CMD_UNDO, CMD_UNDO, &_call<&UIManager::_cmdUndo>, 0, 0},
+      {PLAY, CMD_REDO, CMD_REDO, &_call<&UIManager::_cmdRedo>, 0, 0},
+      {PLAY, CMD_BPM_ENTER, CMD_BPM_ENTER, &_call<&UIManager::_cmdNumberInput>, INPUT_BPM, 0},
+      {PLAY, CMD_GATE_WIDTH_ENTER, CMD_GATE_WIDTH_ENTER, &_call<&UIManager::_cmdNumberInput>, INPUT_GATE_WIDTH, 0},
+      {PLAY, CMD_MIDI_NOTE_ENTER, CMD_MIDI_NOTE_ENTER, &_call<&UIManager::_cmdNumberInput>, INPUT_MIDI_NOTE, 0},
+      {PLAY, CMD_MIDI_CHANNEL_ENTER, CMD_MIDI_CHANNEL_ENTER, &_call<&UIManager::_cmdNumberInput>, INPUT_MIDI_CHANNEL, 0},
+      {PLAY, CMD_CLOCK_SOURCE, CMD_CLOCK_SOURCE, &_call<&UIManager::_cmdClockSourceNext>, 0, 0},
+      {PLAY, CMD_TRACK_1, CMD_TRACK_8, &_call<&UIManager::_cmdSelectTrack>, 0, 1},
+
+      // E. SONG MODE
+      {1 << CTX_SONG, CMD_PLAYLIST_PREV, CMD_PLAYLIST_PREV, &_call<&UIManager::_cmdSlotMove>, -1, 0},
+      {1 << CTX_SONG, CMD_PLAYLIST_NEXT, CMD_PLAYLIST_NEXT, &_call<&UIManager::_cmdSlotMove>, 1, 0},
+      {1 << CTX_SONG, CMD_PLAYLIST_INSERT_PREV, CMD_PLAYLIST_INSERT_NEXT, &_call<&UIManager::_cmdSlotInsert>, 0, 1},
+      {1 << CTX_SONG, CMD_PLAYLIST_DELETE, CMD_PLAYLIST_DELETE, &_call<&UIManager::_cmdSlotDelete>, 0, 0},
+      {1 << CTX_SONG, CMD_PLAYLIST_BANK_1, CMD_PLAYLIST_BANK_4, &_call<&UIManager::_cmdSelectBank>, 0, 16},
+      {1 << CTX_SONG, CMD_TRIGGER_1, CMD_TRIGGER_16, &_call<&UIManager::_cmdSlotPattern>, 0, 1},
+      {1 << CTX_SONG, CMD_PATTERN_PREV, CMD_PATTERN_PREV, &_call<&UIManager::_cmdSlotPatternStep>, -1, 0},
+      {1 << CTX_SONG, CMD_PATTERN_NEXT, CMD_PATTERN_NEXT, &_call<&UIManager::_cmdSlotPatternStep>, 1, 0},
+
+      // F. PATTERN / PERFORM MODE
+      {1 << CTX_PATTERN, CMD_PATTERN_PREV, CMD_PATTERN_PREV, &_call<&UIManager::_cmdPatternStep>, -1, 0},
+      {1 << CTX_PATTERN, CMD_PATTERN_NEXT, CMD_PATTERN_NEXT, &_call<&UIManager::_cmdPatternStep>, 1, 0},
+      {1 << CTX_PATTERN, CMD_TRACK_PREV, CMD_TRACK_PREV, &_call<&UIManager::_cmdTrackStep>, -1, 0},
+      {1 << CTX_PATTERN, CMD_TRACK_NEXT, CMD_TRACK_NEXT, &_call<&UIManager::_cmdTrackStep>, 1, 0},
+      {1 << CTX_PATTERN, CMD_CLEAR_PROMPT, CMD_CLEAR_PROMPT, &_call<&UIManager::_cmdClearPrompt>, 0, 0},
+      {1 << CTX_PATTERN, CMD_TRIGGER_1, CMD_TRIGGER_16, &_call<&UIManager::_handleTrigger>, 0, 1},
+
+      // G. HARDWARE TEST: ahead of everything, even an open menu
+      {ALL, CMD_TEST_TOGGLE, CMD_TEST_TOGGLE, &_call<&UIManager::_cmdTestToggle>, 0, 0},
+  };
+
+  CommandTable table{};
+  for (const CommandRule &rule : rules)
+    for (int ctx = 0; ctx < NUM_CONTEXTS; ctx++)
     {
-      switch (cmd)
+      if (!(rule.contexts & (1 << ctx)))
+        continue;
+      for (int cmd = rule.first; cmd <= rule.last; cmd++)
       {
-      case CMD_TRIGGER_1:
-        _model.setQuantization(Q_BAR);
-        break;
-      case CMD_TRIGGER_2:
-        _model.setQuantization(Q_QUARTER);
-        break;
-      case CMD_TRIGGER_3:
-        _model.setQuantization(Q_EIGHTH);
-        break;
-      case CMD_TRIGGER_4:
-        _model.setQuantization(Q_INSTANT);
-        break;
-      default:
-        break;
+        table.routes[ctx][cmd].handler = rule.handler;
+        table.routes[ctx][cmd].arg = rule.arg + (cmd - rule.first) * rule.step;
       }
-      _currentMode = UI_MODE_PERFORM;
-    }
-    else
-    {
-      _currentMode = UI_MODE_PERFORM;
     }
-    return;
-  }
-
-  // B. CLEAR PROMPT
-  if (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK ||
-      _currentMode == UI_MODE_CONFIRM_CLEAR_PATTERN)
-  {
-    bool isYes = (cmd == CMD_CONFIRM_YES || cmd == CMD_SONG_MODE_TOGGLE);
-    if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_4)
-      isYes = true;
+  return table;
+}
 
-    bool isNo = (cmd == CMD_CONFIRM_NO);
-    if (cmd >= CMD_TRIGGER_13 && cmd <= CMD_TRIGGER_16)
-      isNo = true;
+constexpr UIManager::CommandTable UIManager::_commandTable = UIManager::_buildCommandTable();
 
-    if (isYes)
-    {
-      if (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK)
-        _model.clearTrack(_model.activeTrackID);
-      else
-        _model.clearCurrentPattern();
-      _currentMode = UI_MODE_STEP_EDIT;
-    }
-    else if (isNo || cmd == CMD_CLEAR_PROMPT)
-    {
-      if (cmd == CMD_CLEAR_PROMPT)
-        _currentMode = (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK) ? UI_MODE_CONFIRM_CLEAR_PATTERN : UI_MODE_CONFIRM_CLEAR_TRACK;
-      else
-        _currentMode = UI_MODE_STEP_EDIT;
-    }
-    return;
+// ----------------------------------------------------------------------
+// HANDLERS
+// ----------------------------------------------------------------------
+void UIManager::_cmdTestToggle(int)
+{
+  if (_model.getPlayMode() == MODE_HARDWARE_TEST)
+  {
+    _model.setPlayMode(MODE_PATTERN_LOOP);
+    _model.stop();
   }
-
-  // --- PRIORITY 3: GLOBAL KEYS ---
-  switch (cmd)
+  else
   {
-  case CMD_TRANSPORT_TOGGLE:
-    _model.isPlaying() ? _model.stop() : _model.play();
-    return;
+    _model.setPlayMode(MODE_HARDWARE_TEST);
+  }
+}
 
-  case CMD_QUANTIZE_MENU:
-    _currentMode = UI_MODE_QUANTIZE_MENU;
-    return;
+void UIManager::_cmdCloseMenu(int)
+{
+  _currentMode = UI_MODE_PERFORM;
+}
 
-  case CMD_MODE_TOGGLE:
-    _currentMode = (_currentMode == UI_MODE_STEP_EDIT) ? UI_MODE_PERFORM : UI_MODE_STEP_EDIT;
-    return;
+void UIManager::_cmdSetQuantization(int mode)
+{
+  _model.setQuantization((QuantizationMode)mode);
+  _currentMode = UI_MODE_PERFORM;
+}
 
-  case CMD_SONG_MODE_TOGGLE:
-  {
-    PlayMode pm = _model.getPlayMode();
-    _model.setPlayMode(pm == MODE_PATTERN_LOOP ? MODE_SONG : MODE_PATTERN_LOOP);
-    if (_model.getPlayMode() == MODE_SONG)
-      _songModeBankOffset = 0;
-  }
-    return;
+void UIManager::_cmdConfirmClear(int)
+{
+  if (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK)
+    _model.clearTrack(_model.activeTrackID);
+  else
+    _model.clearCurrentPattern();
+  _currentMode = UI_MODE_STEP_EDIT;
+}
 
-  case CMD_UNDO:
-    _model.undo();
-    return;
+void UIManager::_cmdCancelClear(int)
+{
+  _currentMode = UI_MODE_STEP_EDIT;
+}
 
-  case CMD_BPM_ENTER:
-    _currentMode = UI_MODE_BPM_INPUT;
-    _inputPtr = 0;
-    memset(_inputBuffer, 0, sizeof(_inputBuffer));
-    return;
+void UIManager::_cmdCycleClear(int)
+{
+  _currentMode = (_currentMode == UI_MODE_CONFIRM_CLEAR_TRACK) ? UI_MODE_CONFIRM_CLEAR_PATTERN : UI_MODE_CONFIRM_CLEAR_TRACK;
+}
 
-  default:
-    break;
-  }
+void UIManager::_cmdTransportToggle(int)
+{
+  _model.isPlaying() ? _model.stop() : _model.play();
+}
 
-  // --- PRIORITY 4: CONTEXT SPECIFIC ---
+void UIManager::_cmdOpenQuantizeMenu(int)
+{
+  _currentMode = UI_MODE_QUANTIZE_MENU;
+}
 
-  // A. SONG MODE
+void UIManager::_cmdModeToggle(int)
+{
+  _currentMode = (_currentMode == UI_MODE_STEP_EDIT) ? UI_MODE_PERFORM : UI_MODE_STEP_EDIT;
+}
+
+void UIManager::_cmdSongModeToggle(int)
+{
+  PlayMode pm = _model.getPlayMode();
+  _model.setPlayMode(pm == MODE_PATTERN_LOOP ? MODE_SONG : MODE_PATTERN_LOOP);
   if (_model.getPlayMode() == MODE_SONG)
-  {
-    switch (cmd)
-    {
-    case CMD_PLAYLIST_PREV:
-      if (_uiSelectedSlot > 0)
-        _uiSelectedSlot--;
-      break;
-    case CMD_PLAYLIST_NEXT:
-      if (_uiSelectedSlot < _model.getPlaylistLength() - 1)
-        _uiSelectedSlot++;
-      break;
-    case CMD_PLAYLIST_INSERT_PREV:
-      _model.insertPlaylistSlot(_uiSelectedSlot, _model.getPlaylistPattern(_uiSelectedSlot));
-      break;
-    case CMD_PLAYLIST_INSERT_NEXT:
-      _model.insertPlaylistSlot(_uiSelectedSlot + 1, _model.getPlaylistPattern(_uiSelectedSlot));
-      _uiSelectedSlot++;
-      break;
-    case CMD_PLAYLIST_DELETE:
-      _model.deletePlaylistSlot(_uiSelectedSlot);
-      if (_uiSelectedSlot >= _model.getPlaylistLength())
-        _uiSelectedSlot = max(0, _model.getPlaylistLength() - 1);
-      break;
+    _songModeBankOffset = 0;
+}
 
-    case CMD_PLAYLIST_BANK_1:
-      _songModeBankOffset = 0;
-      break;
-    case CMD_PLAYLIST_BANK_2:
-      _songModeBankOffset = 16;
-      break;
-    case CMD_PLAYLIST_BANK_3:
-      _songModeBankOffset = 32;
-      break;
-    case CMD_PLAYLIST_BANK_4:
-      _songModeBankOffset = 48;
-      break;
+void UIManager::_cmdUndo(int)
+{
+  _model.undo();
+}
 
-    case CMD_TRIGGER_1:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 0);
-      break;
-    case CMD_TRIGGER_2:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 1);
-      break;
-    case CMD_TRIGGER_3:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 2);
-      break;
-    case CMD_TRIGGER_4:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 3);
-      break;
-    case CMD_TRIGGER_5:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 4);
-      break;
-    case CMD_TRIGGER_6:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 5);
-      break;
-    case CMD_TRIGGER_7:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 6);
-      break;
-    case CMD_TRIGGER_8:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 7);
-      break;
-    case CMD_TRIGGER_9:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 8);
-      break;
-    case CMD_TRIGGER_10:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 9);
-      break;
-    case CMD_TRIGGER_11:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 10);
-      break;
-    case CMD_TRIGGER_12:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 11);
-      break;
-    case CMD_TRIGGER_13:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 12);
-      break;
-    case CMD_TRIGGER_14:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 13);
-      break;
-    case CMD_TRIGGER_15:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 14);
-      break;
-    case CMD_TRIGGER_16:
-      _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + 15);
-      break;
+void UIManager::_cmdRedo(int)
+{
+  _model.redo();
+}
 
-    case CMD_PATTERN_NEXT:
-    {
-      int p = (_model.getPlaylistPattern(_uiSelectedSlot) + 1) % MAX_PATTERNS;
-      _model.setPlaylistPattern(_uiSelectedSlot, p);
-      break;
-    }
-    case CMD_PATTERN_PREV:
-    {
-      int p = _model.getPlaylistPattern(_uiSelectedSlot) - 1;
-      if (p < 0)
-        p = MAX_PATTERNS - 1;
-      _model.setPlaylistPattern(_uiSelectedSlot, p);
-      break;
-    }
+void UIManager::_cmdNumberInput(int target)
+{
+  _currentMode = UI_MODE_NUMBER_INPUT;
+  _inputTarget = (NumberInputTarget)target;
+  _inputPtr = 0;
+  memset(_inputBuffer, 0, sizeof(_inputBuffer));
+}
 
-    case CMD_TRACK_1:
-      _model.activeTrackID = 0;
-      break;
-    case CMD_TRACK_2:
-      _model.activeTrackID = 1;
-      break;
-    case CMD_TRACK_3:
-      _model.activeTrackID = 2;
-      break;
-    case CMD_TRACK_4:
-      _model.activeTrackID = 3;
-      break;
-    case CMD_TRACK_5:
-      _model.activeTrackID = 4;
-      break;
-    case CMD_TRACK_6:
-      _model.activeTrackID = 5;
+void UIManager::_cmdInputDigit(int digit)
+{
+  if (_inputPtr < (int)sizeof(_inputBuffer) - 1)
+    _inputBuffer[_inputPtr++] = (char)('0' + digit);
+}
+
+void UIManager::_cmdInputDelete(int)
+{
+  if (_inputPtr > 0)
+    _inputBuffer[--_inputPtr] = 0;
+}
+
+void UIManager::_cmdInputEnter(int)
+{
+  if (_inputPtr > 0)
+  {
+    int value = atoi(_inputBuffer);
+    switch (_inputTarget)
+    {
+    case INPUT_BPM:
+      if (value >= BPM_INPUT_MIN && value <= BPM_INPUT_MAX)
+        _model.setBPM(value);
       break;
-    case CMD_TRACK_7:
-      _model.activeTrackID = 6;
+    case INPUT_GATE_WIDTH:
+      _model.setTrackGateWidth(_model.activeTrackID, min(value, MAX_PULSE_WIDTH_MS));
       break;
-    case CMD_TRACK_8:
-      _model.activeTrackID = 7;
+    case INPUT_MIDI_NOTE:
+      _model.setTrackMidiNote(_model.activeTrackID, min(value, 127));
       break;
-    default:
+    case INPUT_MIDI_CHANNEL:
+      _model.setTrackMidiChannel(_model.activeTrackID, min(value, 16));
       break;
     }
-    return;
   }
+  _currentMode = UI_MODE_STEP_EDIT;
+}
 
-  // B. PATTERN / PERFORM MODE
-  switch (cmd)
-  {
-  case CMD_TRACK_1:
-    _model.activeTrackID = 0;
-    break;
-  case CMD_TRACK_2:
-    _model.activeTrackID = 1;
-    break;
-  case CMD_TRACK_3:
-    _model.activeTrackID = 2;
-    break;
-  case CMD_TRACK_4:
-    _model.activeTrackID = 3;
-    break;
-  case CMD_TRACK_5:
-    _model.activeTrackID = 4;
-    break;
-  case CMD_TRACK_6:
-    _model.activeTrackID = 5;
-    break;
-  case CMD_TRACK_7:
-    _model.activeTrackID = 6;
-    break;
-  case CMD_TRACK_8:
-    _model.activeTrackID = 7;
-    break;
+void UIManager::_cmdInputCancel(int)
+{
+  _currentMode = UI_MODE_STEP_EDIT;
+}
 
-  case CMD_PATTERN_PREV:
+void UIManager::_cmdClockSourceNext(int)
+{
+  _model.setClockSource((ClockSource)((_model.getClockSource() + 1) % NUM_CLOCK_SOURCES));
+}
+
+void UIManager::_cmdSelectTrack(int trackID)
+{
+  _model.activeTrackID = trackID;
+}
+
+void UIManager::_cmdSlotMove(int dir)
+{
+  if (dir < 0 && _uiSelectedSlot > 0)
+    _uiSelectedSlot--;
+  else if (dir > 0 && _uiSelectedSlot < _model.getPlaylistLength() - 1)
+    _uiSelectedSlot++;
+}
+
+// 0: duplicate before the cursor, 1: after it (and follow it)
+void UIManager::_cmdSlotInsert(int after)
+{
+  _model.insertPlaylistSlot(_uiSelectedSlot + after, _model.getPlaylistPattern(_uiSelectedSlot));
+  _uiSelectedSlot += after;
+}
+
+void UIManager::_cmdSlotDelete(int)
+{
+  _model.deletePlaylistSlot(_uiSelectedSlot);
+}
+
+void UIManager::_cmdSelectBank(int offset)
+{
+  _songModeBankOffset = offset;
+}
+
+void UIManager::_cmdSlotPattern(int index)
+{
+  _model.setPlaylistPattern(_uiSelectedSlot, _songModeBankOffset + index);
+}
+
+void UIManager::_cmdSlotPatternStep(int dir)
+{
+  int p = (_model.getPlaylistPattern(_uiSelectedSlot) + dir + MAX_PATTERNS) % MAX_PATTERNS;
+  _model.setPlaylistPattern(_uiSelectedSlot, p);
+}
+
+void UIManager::_cmdPatternStep(int dir)
+{
+  if (dir < 0)
     _model.prevPattern();
-    break;
-  case CMD_PATTERN_NEXT:
+  else
     _model.nextPattern();
-    break;
+}
 
-  case CMD_TRACK_NEXT:
-    if (_model.activeTrackID < NUM_TRACKS - 1)
-      _model.activeTrackID++;
-    break;
-  case CMD_TRACK_PREV:
-    if (_model.activeTrackID > 0)
-      _model.activeTrackID--;
-    break;
-  case CMD_CLEAR_PROMPT:
-    _currentMode = UI_MODE_CONFIRM_CLEAR_TRACK;
-    break;
-
-  case CMD_TRIGGER_1:
-    _handleTrigger(0);
-    break;
-  case CMD_TRIGGER_2:
-    _handleTrigger(1);
-    break;
-  case CMD_TRIGGER_3:
-    _handleTrigger(2);
-    break;
-  case CMD_TRIGGER_4:
-    _handleTrigger(3);
-    break;
-  case CMD_TRIGGER_5:
-    _handleTrigger(4);
-    break;
-  case CMD_TRIGGER_6:
-    _handleTrigger(5);
-    break;
-  case CMD_TRIGGER_7:
-    _handleTrigger(6);
-    break;
-  case CMD_TRIGGER_8:
-    _handleTrigger(7);
-    break;
-  case CMD_TRIGGER_9:
-    _handleTrigger(8);
-    break;
-  case CMD_TRIGGER_10:
-    _handleTrigger(9);
-    break;
-  case CMD_TRIGGER_11:
-    _handleTrigger(10);
-    break;
-  case CMD_TRIGGER_12:
-    _handleTrigger(11);
-    break;
-  case CMD_TRIGGER_13:
-    _handleTrigger(12);
-    break;
-  case CMD_TRIGGER_14:
-    _handleTrigger(13);
-    break;
-  case CMD_TRIGGER_15:
-    _handleTrigger(14);
-    break;
-  case CMD_TRIGGER_16:
-    _handleTrigger(15);
-    break;
+void UIManager::_cmdTrackStep(int dir)
+{
+  int t = _model.activeTrackID + dir;
+  if (t >= 0 && t < NUM_TRACKS)
+    _model.activeTrackID = t;
+}
 
-  default:
-    break;
-  }
+void UIManager::_cmdClearPrompt(int)
+{
+  _currentMode = UI_MODE_CONFIRM_CLEAR_TRACK;
 }
 
 void UIManager::_handleTrigger(int stepIndex)
 {
   if (_currentMode == UI_MODE_PERFORM)
   {
-    if (stepIndex < 4)
-      _clock.manualTrigger(1 << stepIndex);
+    // Steps 1-8 (keyboard 1-8) are the track outputs
+    if (stepIndex < NUM_TRACKS)
+      _clock.manualTrigger(1 << stepIndex, _commandTime);
   }
   else
   {
-    _model.createSnapshot();
     _model.toggleStep(_model.activeTrackID, stepIndex);
   }
 }
 
-void UIManager::_handleBPMInput(int key)
-{
-  if (key >= '0' && key <= '9')
-  {
-    if (_inputPtr < 3)
-    {
-      _inputBuffer[_inputPtr] = (char)key;
-      _inputPtr++;
-    }
-  }
-  if (key == ASCII_CR || key == ASCII_LF)
-  {
-    if (_inputPtr > 0)
-    {
-      int newBPM = atoi(_inputBuffer);
-      if (newBPM >= 30 && newBPM <= 300)
-        _model.setBPM(newBPM);
-    }
-    _currentMode = UI_MODE_STEP_EDIT;
-  }
-  if (key == ASCII_ESC)
-    _currentMode = UI_MODE_STEP_EDIT;
-  if ((key == ASCII_BS || key == ASCII_DEL) && _inputPtr > 0)
-  {
-    _inputPtr--;
-    _inputBuffer[_inputPtr] = 0;
-  }
-}
-
 const char *UIManager::getInputBuffer() const { return _inputBuffer; }
\ No newline at end of file
@@ -6,17 +6,27 @@
 #include "AnalogInput.h"
 #include "InputCommands.h"
 #include "KeyMatrix.h"
+#include "UsbKeyboard.h"
 
 enum InterfaceMode
 {
   UI_MODE_STEP_EDIT,
   UI_MODE_PERFORM,
-  UI_MODE_BPM_INPUT,
+  UI_MODE_NUMBER_INPUT,
   UI_MODE_CONFIRM_CLEAR_TRACK,
   UI_MODE_CONFIRM_CLEAR_PATTERN,
   UI_MODE_QUANTIZE_MENU
 };
 
+// What a number typed in UI_MODE_NUMBER_INPUT sets
+enum NumberInputTarget
+{
+  INPUT_BPM,
+  INPUT_GATE_WIDTH,   // Active track, ms
+  INPUT_MIDI_NOTE,    // Active track, 0-127
+  INPUT_MIDI_CHANNEL, // Active track, 1-16
+};
+
 class UIManager
 {
 public:
@@ -25,11 +35,15 @@ public:
   void init();
   void processInput();
 
-  void handleKeyPress(int key);
   void handleCommand(InputCommand cmd);
 
   InterfaceMode getMode() const { return _currentMode; };
+
+  // Moves whenever any UI state the display shows changes (mode, input
+  // buffer, selection, active track/pattern, swing overlay)
+  uint32_t getVersion() const { return _version; }
   const char *getInputBuffer() const;
+  NumberInputTarget getInputTarget() const { return _inputTarget; }
   int getSelectedSlot() const { return _uiSelectedSlot; }
   int getSongModeBankOffset() const { return _songModeBankOffset; }
 
@@ -43,14 +57,17 @@ private:
   ClockEngine &_clock;
 
   InterfaceMode _currentMode;
+  uint32_t _version;
 
   // INPUTS
   AnalogInput _tempoPot;
   AnalogInput _paramPot;
   KeyMatrix _keyMatrix;
+  UsbKeyboard _usbKeyboard;
 
   char _inputBuffer[4];
   int _inputPtr;
+  NumberInputTarget _inputTarget;
   int _uiSelectedSlot;
   int _songModeBankOffset;
 
@@ -59,7 +76,87 @@ private:
   int _lastSwingValue;
 
   void _handleTrigger(int stepIndex);
-  void _handleBPMInput(int key);
 
-  InputCommand _mapMatrixToCommand(int switchID);
+  // When the input behind the current command happened (micros())
+  uint32_t _commandTime;
+
+  InputCommand _mapMatrixToCommand(const KeyEvent &event);
+  InputCommand _mapKeyToCommand(const KeyEvent &event);
+  static bool _isRepeatable(InputCommand cmd);
+
+  // ---- COMMAND DISPATCH ----
+  enum CommandContext
+  {
+    CTX_QUANTIZE_MENU,
+    CTX_CONFIRM_CLEAR,
+    CTX_NUMBER_INPUT,
+    CTX_SONG,
+    CTX_PATTERN, // Pattern loop, perform and hardware test
+    NUM_CONTEXTS
+  };
+
+  // A plain function pointer: half the size of a pointer to member, and
+  // called without the this-adjustment a member pointer carries. _call
+  // wraps each handler so the member call inlines into it.
+  typedef void (*CommandHandler)(UIManager &ui, int arg);
+  template <void (UIManager::*Handler)(int)>
+  static void _call(UIManager &ui, int arg) { (ui.*Handler)(arg); }
+
+  struct CommandRoute
+  {
+    CommandHandler handler = nullptr; // nullptr: ignored in this context
+    int8_t arg = 0;
+  };
+
+  struct CommandTable
+  {
+    CommandRoute routes[NUM_CONTEXTS][NUM_COMMANDS];
+  };
+
+  // Source data for the table: contexts is a bit mask of CommandContext
+  struct CommandRule
+  {
+    uint8_t contexts;
+    int first; // InputCommand, inclusive range
+    int last;
+    CommandHandler handler;
+    int arg;
+    int step;
+  };
+
+  static const CommandTable _commandTable;
+  static constexpr CommandTable _buildCommandTable();
+  CommandContext _getContext() const;
+
+  // Handlers (arg comes from the table)
+  void _cmdTestToggle(int);
+  void _cmdCloseMenu(int);
+  void _cmdSetQuantization(int mode);
+  void _cmdConfirmClear(int);
+  void _cmdCancelClear(int);
+  void _cmdCycleClear(int);
+  void _cmdTransportToggle(int);
+  void _cmdOpenQuantizeMenu(int);
+  void _cmdModeToggle(int);
+  void _cmdSongModeToggle(int);
+  void _cmdUndo(int);
+  void _cmdRedo(int);
+  void _cmdNumberInput(int target);
+  void _cmdInputDigit(int digit);
+  void _cmdInputDelete(int);
+  void _cmdInputEnter(int);
+  void _cmdInputCancel(int);
+  void _cmdClockSourceNext(int);
+  void _cmdSelectTrack(int trackID);
+  void _cmdSlotMove(int dir);
+  void _cmdSlotInsert(int after);
+  void _cmdSlotDelete(int);
+  void _cmdSelectBank(int offset);
+  void _cmdSlotPattern(int index);
+  void _cmdSlotPatternStep(int dir);
+  void _cmdPatternStep(int dir);
+  void _cmdTrackStep(int dir);
+  void _cmdClearPrompt(int);
+
+  friend struct UIManagerTest; // Host test against the pre-table ladders
 };
\ No newline at end of file
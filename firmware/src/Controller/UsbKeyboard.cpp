@@ -0,0 +1,87 @@
+#include "UsbKeyboard.h"
+
+// USBHost_t36 reports modifier bit n of the boot report as keycode 103 + n
+#define RAW_MODIFIER_BASE 103
+#define RAW_LEFT_SHIFT (RAW_MODIFIER_BASE + 1)
+#define RAW_RIGHT_SHIFT (RAW_MODIFIER_BASE + 5)
+
+UsbKeyboard *UsbKeyboard::_instance = nullptr;
+
+UsbKeyboard::UsbKeyboard()
+{
+  _instance = this;
+  _shiftKeys = 0;
+  _heldKey = KeyEvent();
+  _holding = false;
+  _repeatAt = 0;
+}
+
+void UsbKeyboard::onRawPress(uint8_t keycode)
+{
+  if (_instance)
+    _instance->_handleKey(keycode, KEY_PRESS);
+}
+
+void UsbKeyboard::onRawRelease(uint8_t keycode)
+{
+  if (_instance)
+    _instance->_handleKey(keycode, KEY_RELEASE);
+}
+
+// A full queue drops the event rather than blocking the USB driver
+void UsbKeyboard::_handleKey(uint8_t keycode, KeyEventType type)
+{
+  uint32_t now = micros();
+
+  // Shift only changes the modifier state, like Switch 32 on the matrix
+  uint8_t shiftBit = 0;
+  if (keycode == RAW_LEFT_SHIFT)
+    shiftBit = 0x01;
+  else if (keycode == RAW_RIGHT_SHIFT)
+    shiftBit = 0x02;
+
+  if (shiftBit)
+  {
+    if (type == KEY_PRESS)
+      _shiftKeys |= shiftBit;
+    else
+      _shiftKeys &= ~shiftBit;
+    return;
+  }
+
+  KeyEvent event;
+  event.time = now;
+  event.switchID = keycode;
+  event.type = type;
+  event.modifiers = isShiftHeld() ? MOD_SHIFT : 0;
+  _events.push(event);
+}
+
+bool UsbKeyboard::getNextEvent(KeyEvent &event)
+{
+  if (_events.pop(event))
+  {
+    // A new press takes over the repeat; releasing any other key leaves it
+    if (event.type == KEY_PRESS)
+    {
+      _heldKey = event;
+      _holding = true;
+      _repeatAt = event.time + KEY_HOLD_MS * 1000UL;
+    }
+    else if (event.switchID == _heldKey.switchID)
+      _holding = false;
+    return true;
+  }
+
+  if (!_holding || (int32_t)(micros() - _repeatAt) < 0)
+    return false;
+
+  // Stamped when it was due. The next one is timed from now, so a stalled
+  // loop() gets one repeat rather than a burst.
+  event = _heldKey;
+  event.time = _repeatAt;
+  event.type = (_heldKey.type == KEY_PRESS) ? KEY_HOLD : KEY_REPEAT;
+  _heldKey.type = event.type;
+  _repeatAt = micros() + KEY_REPEAT_MS * 1000UL;
+  return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "SpscQueue.h"
+#include "KeyMatrix.h"
+
+// Raw key events from the USB host keyboard driver. The driver reports
+// the boot-protocol report as HID usage IDs, with a press and a release
+// for every key (6-key rollover plus modifiers), instead of translated
+// ASCII presses. Events are stamped on arrival and queued exactly like
+// matrix events, with KeyEvent::switchID holding the usage ID.
+//
+// Boot keyboards don't repeat on their own, so the last key pressed gets
+// the matrix's KEY_HOLD and KEY_REPEAT events, generated as the queue is
+// read, until its release comes through.
+class UsbKeyboard
+{
+public:
+  UsbKeyboard();
+
+  // Pops the next event from the queue, or the held key's next hold or
+  // repeat once it is due. Returns false if there is none.
+  bool getNextEvent(KeyEvent &event);
+
+  // Either Shift key, live state
+  bool isShiftHeld() const { return _shiftKeys != 0; }
+
+  // Pass these to KeyboardController::attachRawPress/attachRawRelease.
+  // They run in the USB host driver's context, so they only queue.
+  static void onRawPress(uint8_t keycode);
+  static void onRawRelease(uint8_t keycode);
+
+private:
+  static UsbKeyboard *_instance;
+
+  volatile uint8_t _shiftKeys; // Bit per Shift key currently down
+
+  // USB driver -> loop()
+  SpscQueue<KeyEvent, KEY_EVENT_QUEUE_SIZE> _events;
+
+  // Auto-repeat, loop() only
+  KeyEvent _heldKey;  // The press being repeated
+  bool _holding;      // Until the held key's release is popped
+  uint32_t _repeatAt; // micros() of the next hold or repeat
+
+  void _handleKey(uint8_t keycode, KeyEventType type);
+};
@@ -1,9 +1,17 @@
 #include "ClockEngine.h"
+#include "Profiler.h"
 
-// 96 PPQN Constants
-#define PPQN 96
-#define TICKS_PER_STEP 24
-#define MAX_SWING_TICKS 12
+// Tick duration scaling
+// One PPQN tick lasts (6,000,000,000 / PPQN) / centiBPM microseconds.
+// Keeping the remainder in "us * centiBPM" turns that into an exact integer
+// division, so the schedule never drifts no matter how long the set runs.
+#define US_CENTIBPM_PER_TICK (6000000000ULL / PPQN)
+
+// Wrap-safe "has this micros() timestamp been reached yet?"
+static inline bool isDue(uint32_t when, uint32_t now)
+{
+  return (int32_t)(now - when) >= 0;
+}
 
 ClockEngine *ClockEngine::_instance = nullptr;
 
@@ -12,16 +20,47 @@ ClockEngine::ClockEngine(SequencerModel &model, OutputDriver &driver)
 {
   _instance = this;
   _cachedBPM = 0;
-  _accumulatedTime = 0;
-  _pulseCounter = 0;
-  _triggersActive = false;
-  _running = false;
+
+  _rendering = false;
   _isFirstTick = false;
+  _tickBPM = DEFAULT_BPM * 100;
+  _nextTickTime = 0;
+  _tickRemainder = 0;
+
+  _haveStartPulse = false;
+  _startPulseTime = 0;
+  _syncRemainder = 0;
+  _renderedTicks = 0;
+  _renderedPulses = 0;
+  _syncPulses = 0;
+
+  _generation = 0;
+  _playing = false;
+  _renderedUntil = 0;
+
+  _playhead = 0;
+  _stepCount = 0;
+  _stepEdgeTime = 0;
+  _starving = false;
+  resetLookaheadStats();
+
+  _gateMask = 0;
+  _nextGateOff = 0;
+  for (int t = 0; t < NUM_TRACKS; t++)
+    _gateOffTime[t] = 0;
 }
 
 void ClockEngine::init()
 {
-  _timer.begin(onTick, 500);
+  _sync.begin();
+#ifdef MIDI_OUT
+  _midi.begin();
+#endif
+#ifdef CLOCK_EVENT_SCHEDULER
+  _timer.begin(onTick, CLOCK_MIN_DELAY_US);
+#else
+  _timer.begin(onTick, CLOCK_POLL_INTERVAL_US);
+#endif
 }
 
 void ClockEngine::onTick()
@@ -30,143 +69,520 @@ void ClockEngine::onTick()
     _instance->_handleTick();
 }
 
-void ClockEngine::manualTrigger(uint16_t mask)
+void ClockEngine::manualTrigger(uint16_t mask, uint32_t inputTime)
 {
+  noInterrupts();
   _driver.setTriggers(mask);
-  _pulseCounter = 0;
-  _triggersActive = true;
+  uint32_t now = micros();
+  _openGates(mask, now);
+  interrupts();
+
+  PROFILE_MICROS(PROF_INPUT_LATENCY, now - inputTime);
+  (void)inputTime; // Only read in PROFILE_MODE
+
+  // The gate-off time has to be scheduled
+  _wake();
+}
+
+uint32_t ClockEngine::getStepCount(uint32_t &edgeTime) const
+{
+  // Both written by the ISR; read them as a pair
+  noInterrupts();
+  uint32_t count = _stepCount;
+  edgeTime = _stepEdgeTime;
+  interrupts();
+  return count;
 }
 
+void ClockEngine::resetLookaheadStats()
+{
+  // The ISR updates both
+  noInterrupts();
+  _underruns = 0;
+  _minLeadUs = CLOCK_LOOKAHEAD_US;
+  interrupts();
+}
+
+// -------------------------------------------------------------------------
+// ISR: PLAY OUT RENDERED EVENTS
+// -------------------------------------------------------------------------
 void ClockEngine::_handleTick()
 {
-  if (_model.getPlayMode() == MODE_HARDWARE_TEST)
-  {
-    return;
-  }
+  PROFILE_BEGIN(PROF_CLOCK_ISR);
+  uint32_t now = micros();
 
   // PULSE MANAGEMENT
-  if (_triggersActive)
+  // Constant-cost check; the per-gate scan only runs when one is due
+  if (_gateMask && isDue(_nextGateOff, now))
+    _closeExpiredGates(now);
+
+  // EVENT PLAYBACK
+  uint8_t generation = _generation;
+  const ClockEvent *event;
+  while ((event = _events.peek()) && (event->generation != generation || isDue(event->time, now)))
   {
-    _pulseCounter++;
-    if (_pulseCounter >= 30)
+    if (event->generation == generation)
     {
-      _driver.clearAllTriggers();
-      _triggersActive = false;
+      if (event->fireMask)
+      {
+        _driver.setTriggers(event->fireMask);
+        PROFILE_EDGE(PROF_CLOCK_ISR, event->time, now);
+        _openGates(event->fireMask, now);
+      }
+      if (event->flags & EVENT_STEP_START)
+      {
+        _playhead = (event->pattern << 8) | event->step;
+        _stepEdgeTime = now;
+        _stepCount++;
+      }
+#ifdef MIDI_OUT
+      if (event->flags & EVENT_MIDI_START)
+      {
+        _midi.queueSongPosition(event->step, event->time);
+        _midi.queueRealTime(MIDI_START, event->time);
+      }
+      if (event->flags & EVENT_MIDI_CLOCK)
+        _midi.queueRealTime(MIDI_CLOCK, event->time);
+#endif
     }
+    ClockEvent done;
+    _events.pop(done);
   }
 
-  bool isPlaying = _model.isPlaying();
+  _checkLookahead(now);
+  _scheduleNext();
+  PROFILE_END(PROF_CLOCK_ISR);
+}
 
-  if (isPlaying && !_running)
+// Tracks how much rendered future is left. Running dry means the main
+// loop stalled for longer than CLOCK_LOOKAHEAD_US.
+void ClockEngine::_checkLookahead(uint32_t now)
+{
+  if (!_playing)
   {
-    _running = true;
-    _accumulatedTime = _tickInterval;
-    _isFirstTick = true;
+    _starving = false;
+    return;
+  }
+
+  int32_t lead = (int32_t)(_renderedUntil - now);
+  if (lead < _minLeadUs)
+    _minLeadUs = lead;
+
+  if (lead < 0)
+  {
+    if (!_starving)
+      _underruns++; // Count each dry spell once
+    _starving = true;
   }
-  else if (!isPlaying && _running)
+  else
   {
-    _running = false;
+    _starving = false;
   }
+}
 
-  if (!_running)
-    return;
+// Event mode only: arm the one-shot for whatever is due first.
+// Polling mode leaves the periodic timer alone.
+void ClockEngine::_scheduleNext()
+{
+#ifdef CLOCK_EVENT_SCHEDULER
+  uint32_t now = micros();
+  int32_t delay = CLOCK_IDLE_INTERVAL_US;
+
+  const ClockEvent *event = _events.peek();
+  if (event)
+    delay = min(delay, (int32_t)(event->time - now));
+  if (_gateMask)
+    delay = min(delay, (int32_t)(_nextGateOff - now));
+
+  if (delay < CLOCK_MIN_DELAY_US)
+    delay = CLOCK_MIN_DELAY_US;
 
-  // TIME ACCUMULATION
-  _accumulatedTime += 0.5f;
+  // Re-arming a running IntervalTimer restarts its countdown from now
+  _timer.begin(onTick, (unsigned int)delay);
+#endif
+}
+
+// Pulls the next ISR in so that work queued from loop() is seen right
+// away instead of at the next idle wake-up.
+void ClockEngine::_wake()
+{
+#ifdef CLOCK_EVENT_SCHEDULER
+  noInterrupts();
+  _timer.begin(onTick, CLOCK_MIN_DELAY_US);
+  interrupts();
+#endif
+}
 
-  if (_accumulatedTime >= _tickInterval)
+// -------------------------------------------------------------------------
+// GATES
+// -------------------------------------------------------------------------
+// Each output gets its own off-time from its own width, so a new hit on one
+// track never stretches or cuts short a pulse on another. A re-hit on an
+// open gate simply extends it (its MIDI note is struck again).
+// MIDI notes are queued here and in _closeExpiredGates, stamped with the
+// gate edge: at most two messages per track per pass, no allocation.
+void ClockEngine::_openGates(uint16_t mask, uint32_t now)
+{
+  uint32_t next = _nextGateOff;
+  bool hadGates = (_gateMask != 0);
+
+  uint16_t m = mask;
+  while (m)
   {
-    _accumulatedTime -= _tickInterval;
+    int t = __builtin_ctz(m);
+#ifdef MIDI_NOTE_OUT
+    if (_gateMask & (1 << t))
+      _queueNote(MIDI_NOTE_OFF, t, now);
+    _queueNote(MIDI_NOTE_ON, t, now);
+#endif
+    uint32_t offTime = now + _model.getTrackGateWidth(t) * 1000UL;
+    _gateOffTime[t] = offTime;
+    if (!hadGates || (int32_t)(offTime - next) < 0)
+    {
+      next = offTime;
+      hadGates = true;
+    }
+    m &= m - 1;
+  }
+
+  _nextGateOff = next;
+  _gateMask |= mask;
+}
+
+// Drops only the outputs whose time is up and finds the next deadline
+void ClockEngine::_closeExpiredGates(uint32_t now)
+{
+  uint16_t expired = 0;
+  uint32_t next = 0;
+  bool pending = false;
 
-    // --- CORE PPQN LOGIC ---
-    if (_isFirstTick)
+  uint16_t m = _gateMask;
+  while (m)
+  {
+    int t = __builtin_ctz(m);
+    if (isDue(_gateOffTime[t], now))
     {
-      _isFirstTick = false;
-      _checkTriggers(_model.getCurrentStep(), 0);
+      expired |= (1 << t);
+#ifdef MIDI_NOTE_OUT
+      _queueNote(MIDI_NOTE_OFF, t, now);
+#endif
     }
-    else
+    else if (!pending || (int32_t)(_gateOffTime[t] - next) < 0)
     {
-      _model.advanceTick();
+      next = _gateOffTime[t];
+      pending = true;
+    }
+    m &= m - 1;
+  }
 
-      // Quantization Check
-      if (_model.getCurrentTick() == 0)
-      {
-        int currentStep = _model.getCurrentStep();
-        QuantizationMode q = _model.getQuantization();
-        bool readyToSwitch = false;
-
-        switch (q)
-        {
-        case Q_BAR:
-          readyToSwitch = (currentStep == 0);
-          break;
-        case Q_QUARTER:
-          readyToSwitch = (currentStep % 4 == 0);
-          break;
-        case Q_EIGHTH:
-          readyToSwitch = (currentStep % 2 == 0);
-          break;
-        case Q_INSTANT:
-          readyToSwitch = true;
-          break;
-        }
-        if (readyToSwitch)
-          _model.applyPendingPattern();
-      }
+  _driver.clearTriggers(expired);
+  _gateMask &= ~expired;
+  _nextGateOff = next;
+}
+
+#ifdef MIDI_NOTE_OUT
+void ClockEngine::_queueNote(uint8_t status, int track, uint32_t now)
+{
+  uint8_t velocity = (status == MIDI_NOTE_ON) ? MIDI_NOTE_VELOCITY : 0;
+  _midi.queueNote(status, _model.getTrackMidiChannel(track), _model.getTrackMidiNote(track), velocity, now);
+}
+#endif
+
+// -------------------------------------------------------------------------
+// MAIN LOOP: RENDER AHEAD
+// -------------------------------------------------------------------------
+void ClockEngine::update()
+{
+  PROFILE_BEGIN(PROF_CLOCK_RENDER);
+  int targetBPM = _model.getCentiBPM();
+  if (targetBPM != _cachedBPM)
+  {
+    _cachedBPM = targetBPM;
+    _tickBPM = (_cachedBPM > 0) ? _cachedBPM : DEFAULT_BPM * 100;
+  }
 
-      // Fire Triggers
-      _checkTriggers(_model.getCurrentStep(), _model.getCurrentTick());
+  // A new source starts over: the next pulse (or PLAY) begins the run
+  ClockSource source = _model.getClockSource();
+  if (source != _sync.getSource())
+  {
+    _sync.setSource(source);
+    if (_rendering)
+      _stopRendering();
+  }
+  if (source != CLOCK_INTERNAL)
+  {
+    _serviceSync();
+    _sync.checkTimeout();
+  }
+
+  _render();
+  PROFILE_END(PROF_CLOCK_RENDER);
+}
+
+// -------------------------------------------------------------------------
+// MAIN LOOP: FOLLOW EXTERNAL CLOCK
+// -------------------------------------------------------------------------
+// MIDI Start always restarts from step 0 (Song Position is not followed).
+// The run itself begins on the first pulse after PLAY, in _render().
+void ClockEngine::_serviceSync()
+{
+  SyncEvent event;
+  while (_sync.getNextEvent(event))
+  {
+    switch (event.type)
+    {
+    case SYNC_START:
+      if (_rendering)
+        _stopRendering();
+      _haveStartPulse = false;
+      _model.stop();
+      _model.play();
+      break;
+    case SYNC_STOP:
+      _model.stop();
+      break;
+    case SYNC_PULSE:
+      _onSyncPulse(event.time);
+      break;
     }
   }
 }
 
-void ClockEngine::_checkTriggers(int step, int tick)
+// Pulse k of the run belongs to the k-th pulse-aligned tick rendered. The
+// renderer is CLOCK_LOOKAHEAD_US ahead, so that tick is normally already
+// in the history when its pulse arrives.
+void ClockEngine::_onSyncPulse(uint32_t time)
 {
-  int patID = _model.getPlayingPatternID();
-  uint16_t fireMask = 0;
+  if (!_rendering)
+  {
+    // Nothing to compare with yet; the period is still measured
+    _sync.pulse(time, false, 0);
+    _startPulseTime = time;
+    _haveStartPulse = true;
+    return;
+  }
 
-  for (int t = 0; t < NUM_TRACKS; t++)
+  uint32_t k = _syncPulses++;
+  if (_sync.getTickPeriodQ8() == 0)
+  {
+    // Cold start: the renderer is waiting for this pulse's period
+    _sync.pulse(time, false, 0);
+    return;
+  }
+
+  uint32_t oldest = (_renderedPulses > SYNC_HISTORY) ? _renderedPulses - SYNC_HISTORY : 0;
+  if (k < oldest || k >= _renderedPulses)
   {
-    uint8_t swingAmount = _model.getPlayingTrackSwing(t);
+    // Count lost (a missed or extra pulse, or a tempo jump the lookahead
+    // hasn't caught up with): carry on from the closest rendered pulse
+    uint32_t best = oldest;
+    for (uint32_t i = oldest + 1; i < _renderedPulses; i++)
+      if (abs((int32_t)(time - _pulseTickTimes[i % SYNC_HISTORY])) <
+          abs((int32_t)(time - _pulseTickTimes[best % SYNC_HISTORY])))
+        best = i;
+    k = best;
+    _syncPulses = k + 1;
+  }
+
+  _sync.pulse(time, true, (int32_t)(time - _pulseTickTimes[k % SYNC_HISTORY]));
+}
+
+void ClockEngine::_render()
+{
+  // Queued edits (including play and stop) apply on every pass. Whatever
+  // was rendered last is a whole tick, so this is a tick boundary, and a
+  // slaved cold start that renders nothing still drains the queue.
+  _model.applyPendingEdits();
+
+  bool isPlaying = _model.isPlaying() && _model.getPlayMode() != MODE_HARDWARE_TEST;
+  uint32_t now = micros();
+
+  bool wasEmpty = _events.isEmpty();
+
+  // Slaved, the run waits for a pulse and starts on it. Only a pulse from
+  // this pass counts, so a stale one can't start it late.
+  bool slaved = (_sync.getSource() != CLOCK_INTERNAL);
+  bool canStart = !slaved || _haveStartPulse;
+  _haveStartPulse = false;
+
+  if (isPlaying && !_rendering && canStart)
+  {
+    wasEmpty = true; // Whatever is still queued is stale
+    _rendering = true;
+    _isFirstTick = true;
+    _nextTickTime = (slaved ? _startPulseTime : now) + CLOCK_START_DELAY_US;
+    _tickRemainder = 0;
+    _syncRemainder = 0;
+    _renderedTicks = 0;
+    _renderedPulses = 0;
+    _syncPulses = 1; // The start pulse itself
+    _renderedUntil = _nextTickTime;
+    resetLookaheadStats();
+
+    // The previous run's events were dropped with its generation; shown
+    // until the first tick of this one plays
+    noInterrupts();
+    _playhead = (_model.getPlayingPatternID() << 8) | _model.getCurrentStep();
+    _playing = true;
+    interrupts();
+  }
+  else if (!isPlaying && _rendering)
+  {
+    _stopRendering();
+  }
+
+  if (!_rendering)
+    return;
 
-    int targetTick = 0;
-    // Apply delay only to ODD steps (the "ands" of the beat)
-    if (step % 2 != 0)
+  uint32_t horizon = now + CLOCK_LOOKAHEAD_US;
+
+  // Slaved from a cold start, nothing past the start tick is known until
+  // the next pulse gives the PLL a period. Guessing with the pot tempo
+  // would start the run far out of phase; the few ticks that fall due
+  // meanwhile are played late instead. Waiting on the input is no stall.
+  bool noPeriod = slaved && _sync.getTickPeriodQ8() == 0;
+
+  while ((int32_t)(_nextTickTime - horizon) < 0)
+  {
+    // Queue full: the rest of the window is rendered on a later pass
+    if (_events.count() >= CLOCK_EVENT_QUEUE_SIZE - 1)
+      break;
+    if (noPeriod && !_isFirstTick)
     {
-      targetTick = (swingAmount * MAX_SWING_TICKS) / 100;
+      _renderedUntil = horizon;
+      break;
     }
-
-    if (tick == targetTick)
+    if (!_renderTick())
     {
-      uint16_t trackMask = (1 << t);
-      if (_model.getTriggersForStep(patID, step) & trackMask)
-      {
-        fireMask |= trackMask;
-      }
+      _stopRendering();
+      return;
     }
   }
 
-  if (fireMask > 0)
+  // Starting up (or recovering from a dry spell): don't wait for the idle
+  // wake-up to notice the new events
+  if (wasEmpty && !_events.isEmpty())
+    _wake();
+}
+
+void ClockEngine::_stopRendering()
+{
+  // Anything already queued belongs to the old run: the ISR drops it.
+  // The playhead is cleared with the ISR held off, so it never sees a
+  // stopped run with the old playhead still set.
+  _rendering = false;
+  noInterrupts();
+  _playing = false;
+  _generation++;
+  _playhead = 0;
+  interrupts();
+
+#ifdef MIDI_OUT
+  // After the generation bump, so no clock can follow the Stop
+  _midi.sendRealTimeNow(MIDI_STOP);
+#endif
+}
+
+// Runs the sequencer for exactly one PPQN tick and queues what it produced.
+// Returns false if a queued stop landed on this tick boundary.
+bool ClockEngine::_renderTick()
+{
+  uint32_t tickTime = _nextTickTime;
+  uint8_t flags = 0;
+
+  if (_isFirstTick)
+  {
+    _isFirstTick = false;
+#ifdef MIDI_OUT
+    flags |= EVENT_MIDI_START;
+#endif
+  }
+  else
+  {
+    // EDIT HANDOFF
+    // Queued UI edits land between PPQN ticks, never halfway through one
+    _model.applyPendingEdits();
+    if (!_model.isPlaying())
+      return false;
+
+    _model.advanceTick();
+    if (_model.getCurrentTick() == 0)
+      _checkQuantization();
+  }
+
+  int step = _model.getCurrentStep();
+  int tick = _model.getCurrentTick();
+
+  // Swing is already compiled into the pattern, this is a single lookup
+  uint16_t fireMask = _model.getFireMask(_model.getPlayingPatternID(), step, tick);
+
+  if (tick == 0)
+    flags |= EVENT_STEP_START;
+#ifdef MIDI_OUT
+  if (tick % MIDI_CLOCK_DIVIDER == 0)
+    flags |= EVENT_MIDI_CLOCK;
+#endif
+
+  if (fireMask || flags)
   {
-    _driver.setTriggers(fireMask);
-    _triggersActive = true;
-    _pulseCounter = 0;
+    ClockEvent event;
+    event.time = tickTime;
+    event.fireMask = fireMask;
+    event.step = step;
+    event.pattern = _model.getPlayingPatternID();
+    event.flags = flags;
+    event.generation = _generation;
+    _events.push(event);
   }
+
+  if (_renderedTicks++ % _sync.getTicksPerPulse() == 0)
+    _pulseTickTimes[_renderedPulses++ % SYNC_HISTORY] = tickTime;
+
+  _advanceTickTime();
+  _renderedUntil = _nextTickTime;
+  return true;
 }
 
-void ClockEngine::update()
+// Moves the schedule forward by exactly one PPQN tick.
+// The sub-microsecond remainder is carried, never dropped. Slaved, the PLL
+// sets the period.
+void ClockEngine::_advanceTickTime()
 {
-  int targetBPM = _model.getBPM();
-  if (targetBPM != _cachedBPM)
+  uint32_t periodQ8 = _sync.getTickPeriodQ8();
+  if (periodQ8)
   {
-    _cachedBPM = targetBPM;
-    _calculateInterval(_cachedBPM);
+    uint32_t next = _syncRemainder + periodQ8;
+    _nextTickTime += next >> 8;
+    _syncRemainder = next & 0xFF;
+    return;
   }
+
+  uint32_t remainder = _tickRemainder + (uint32_t)US_CENTIBPM_PER_TICK;
+  _nextTickTime += remainder / _tickBPM;
+  _tickRemainder = remainder % _tickBPM;
 }
 
-void ClockEngine::_calculateInterval(int bpm)
+void ClockEngine::_checkQuantization()
 {
-  if (bpm <= 0)
-    bpm = 120;
-  _tickInterval = 60000.0f / (bpm * 96.0f);
-}
\ No newline at end of file
+  int currentStep = _model.getCurrentStep();
+  QuantizationMode q = _model.getQuantization();
+  bool readyToSwitch = false;
+
+  switch (q)
+  {
+  case Q_BAR:
+    readyToSwitch = (currentStep == 0);
+    break;
+  case Q_QUARTER:
+    readyToSwitch = (currentStep % 4 == 0);
+    break;
+  case Q_EIGHTH:
+    readyToSwitch = (currentStep % 2 == 0);
+    break;
+  case Q_INSTANT:
+    readyToSwitch = true;
+    break;
+  }
+  if (readyToSwitch)
+    _model.applyPendingPattern();
+}
@@ -1,38 +1,135 @@
 #pragma once
 #include <Arduino.h>
 #include "Config.h"
+#include "SpscQueue.h"
 #include "Model/SequencerModel.h"
 #include "OutputDriver.h"
+#include "MidiOutput.h"
+#include "ClockSync.h"
 
+// A rendered PPQN tick, ready to be played at an exact time
+enum ClockEventFlags
+{
+  EVENT_STEP_START = 0x01, // First tick of a step (moves the playhead)
+  EVENT_MIDI_CLOCK = 0x02, // Every MIDI_CLOCK_DIVIDER ticks
+  EVENT_MIDI_START = 0x04, // First tick after PLAY
+};
+
+struct ClockEvent
+{
+  uint32_t time;      // micros() timestamp the event is due
+  uint16_t fireMask;  // Outputs to trigger
+  uint8_t step;       // Step this tick belongs to
+  uint8_t pattern;    // Pattern playing on this tick
+  uint8_t flags;      // ClockEventFlags
+  uint8_t generation; // Stale events from before a stop are dropped
+};
+
+// Split design:
+// - update() runs in loop(). It owns all sequencing logic (edits, pattern
+//   quantization, song advance, swing) and renders the next
+//   CLOCK_LOOKAHEAD_US of ticks into a lock-free queue.
+// - The timer ISR only pops due events, writes the outputs and closes
+//   gates. It never touches the model's playback state.
 class ClockEngine
 {
 public:
   ClockEngine(SequencerModel &model, OutputDriver &driver);
   void init();
   void update();
-  void manualTrigger(uint16_t mask);
+  // inputTime: micros() of the key event behind it, for latency capture
+  void manualTrigger(uint16_t mask, uint32_t inputTime);
   static void onTick();
 
+  // Step and pattern currently heard at the outputs (not the render
+  // position, which the model is at)
+  int getPlayheadStep() const { return _playhead & 0xFF; }
+  int getPlayheadPattern() const { return _playhead >> 8; }
+
+  // Counts step boundaries as they are played. edgeTime receives the
+  // micros() timestamp of the latest one, for latency measurements.
+  uint32_t getStepCount(uint32_t &edgeTime) const;
+
+  // External clock
+  SyncStatus getSyncStatus() const { return _sync.getStatus(); }
+  int getSyncCentiBPM() const { return _sync.getCentiBPM(); }
+  int32_t getSyncPhaseError() const { return _sync.getPhaseError(); }
+
+  // Lookahead health
+  uint32_t getUnderrunCount() const { return _underruns; }
+  int32_t getMinLeadUs() const { return _minLeadUs; } // Closest call since reset
+  void resetLookaheadStats(); // Also done on every transport start
+
 private:
   static ClockEngine *_instance;
   IntervalTimer _timer;
   SequencerModel &_model;
   OutputDriver &_driver;
+#ifdef MIDI_OUT
+  MidiOutput _midi;
+#endif
+  ClockSync _sync;
+
+  int _cachedBPM; // centiBPM
 
-  int _cachedBPM;
+  // RENDER STATE (main loop only)
+  // Absolute micros() schedule, integer only. The remainder is kept in
+  // "us * centiBPM" so that every tempo divides exactly.
+  bool _rendering;
+  bool _isFirstTick;
+  uint32_t _tickBPM; // centiBPM
+  uint32_t _nextTickTime;
+  uint32_t _tickRemainder;
 
-  // Timing State (Float for precision accumulation)
-  volatile float _accumulatedTime;
-  volatile float _tickInterval;
+  // SLAVE STATE (main loop only)
+  // The tick rendered for every input pulse is remembered, so that the
+  // pulse can be compared with it when it arrives
+  bool _haveStartPulse;
+  uint32_t _startPulseTime;
+  uint32_t _syncRemainder;                // 1/256 us
+  uint32_t _renderedTicks;                // Since the start of the run
+  uint32_t _renderedPulses;               // Pulse-aligned ticks among them
+  uint32_t _syncPulses;                   // Input pulses since the start
+  uint32_t _pulseTickTimes[SYNC_HISTORY]; // By pulse index
 
-  volatile unsigned long _pulseCounter;
-  volatile bool _triggersActive;
-  volatile bool _running;
-  volatile bool _isFirstTick;
+  // LOOP -> ISR HANDOFF
+  SpscQueue<ClockEvent, CLOCK_EVENT_QUEUE_SIZE> _events;
+  volatile uint8_t _generation;
+  volatile bool _playing;           // Renderer is producing events
+  volatile uint32_t _renderedUntil; // Every tick before this is queued
 
+  // PLAYBACK STATE (ISR)
+  volatile uint16_t _playhead; // Pattern << 8 | step, stored as one pair
+  volatile uint32_t _stepCount;
+  volatile uint32_t _stepEdgeTime;
+  volatile uint32_t _underruns;
+  volatile int32_t _minLeadUs;
+  bool _starving;
+
+  // Gate State (one independent gate per output)
+  volatile uint16_t _gateMask;       // Outputs currently held ON
+  uint32_t _gateOffTime[NUM_TRACKS]; // When each open gate closes
+  volatile uint32_t _nextGateOff;    // Earliest of the above
+
+  // ISR
   void _handleTick();
-  void _calculateInterval(int bpm);
+  void _openGates(uint16_t mask, uint32_t now);
+  void _closeExpiredGates(uint32_t now);
+#ifdef MIDI_NOTE_OUT
+  void _queueNote(uint8_t status, int track, uint32_t now);
+#endif
+  void _checkLookahead(uint32_t now);
+  void _scheduleNext();
+  void _wake();
+
+  // Slave
+  void _serviceSync();
+  void _onSyncPulse(uint32_t time);
 
-  // Helper to check per-track swing logic
-  void _checkTriggers(int step, int tick);
-};
\ No newline at end of file
+  // Renderer
+  void _render();
+  bool _renderTick();
+  void _stopRendering();
+  void _advanceTickTime();
+  void _checkQuantization();
+};
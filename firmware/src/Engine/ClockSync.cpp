@@ -0,0 +1,190 @@
+#include "ClockSync.h"
+
+// Pulse intervals outside this tempo range are ignored. Wider than the
+// 10-300 BPM the model takes, so jitter at the extremes isn't thrown away.
+#define SYNC_MIN_BPM 5
+#define SYNC_MAX_BPM 400
+
+ClockSync *ClockSync::_instance = nullptr;
+
+ClockSync::ClockSync()
+{
+  _instance = this;
+  _source = CLOCK_INTERNAL;
+  _reset();
+}
+
+void ClockSync::begin()
+{
+  pinMode(PIN_CLOCK_IN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_CLOCK_IN), onPulse, RISING);
+}
+
+void ClockSync::setSource(ClockSource source)
+{
+  _source = source;
+  _events.clear();
+  _reset();
+}
+
+void ClockSync::_reset()
+{
+  _havePulse = false;
+  _lastPulseTime = 0;
+  _periodQ8 = 0;
+  _correctionQ8 = 0;
+  _phaseError = 0;
+  _inWindow = 0;
+  _outWindow = 0;
+  _locked = false;
+}
+
+// -------------------------------------------------------------------------
+// INPUT
+// -------------------------------------------------------------------------
+void ClockSync::onPulse()
+{
+  if (_instance)
+    _instance->_push(CLOCK_PULSE_IN, SYNC_PULSE);
+}
+
+void ClockSync::onMidiClock()
+{
+  if (_instance)
+    _instance->_push(CLOCK_MIDI_IN, SYNC_PULSE);
+}
+
+void ClockSync::onMidiStart()
+{
+  if (_instance)
+    _instance->_push(CLOCK_MIDI_IN, SYNC_START);
+}
+
+void ClockSync::onMidiStop()
+{
+  if (_instance)
+    _instance->_push(CLOCK_MIDI_IN, SYNC_STOP);
+}
+
+// Input from the source that isn't selected is ignored, so there is only
+// ever one producer. A full queue drops the event.
+void ClockSync::_push(ClockSource from, SyncEventType type)
+{
+  if (_source != from)
+    return;
+  SyncEvent event;
+  event.time = micros();
+  event.type = type;
+  _events.push(event);
+}
+
+bool ClockSync::getNextEvent(SyncEvent &event)
+{
+  return _events.pop(event);
+}
+
+// -------------------------------------------------------------------------
+// PLL
+// -------------------------------------------------------------------------
+void ClockSync::pulse(uint32_t time, bool hasPhase, int32_t phaseError)
+{
+  uint32_t minPeriod = 60000000UL / (SYNC_MAX_BPM * _pulsesPerQuarter());
+  uint32_t maxPeriod = 60000000UL / (SYNC_MIN_BPM * _pulsesPerQuarter());
+
+  // PERIOD
+  // Filtered, except for a clear tempo jump, which is taken as is so a
+  // new tempo locks in a few pulses rather than a few dozen
+  int32_t intervalError = 0;
+  if (_havePulse)
+  {
+    uint32_t interval = time - _lastPulseTime;
+    if (interval >= minPeriod && interval <= maxPeriod)
+    {
+      uint32_t intervalQ8 = interval << 8;
+      int32_t delta = (int32_t)(intervalQ8 - _periodQ8);
+      if (_periodQ8 == 0 || abs(delta) > (int32_t)(_periodQ8 >> 2))
+        _periodQ8 = intervalQ8;
+      else
+        _periodQ8 += delta >> SYNC_PERIOD_SHIFT;
+      intervalError = delta >> 8;
+    }
+  }
+  _havePulse = true;
+  _lastPulseTime = time;
+
+  // PHASE
+  // Added to the pulse period for the ticks rendered from now on. The
+  // renderer runs CLOCK_LOOKAHEAD_US ahead, so the effect only shows a few
+  // pulses later; the small gain keeps that delay from overshooting.
+  _correctionQ8 = 0;
+  if (hasPhase)
+  {
+    int32_t limit = (int32_t)(_periodQ8 >> 3);
+    int32_t error = constrain(phaseError, -(int32_t)(_periodQ8 >> 8), (int32_t)(_periodQ8 >> 8));
+    _correctionQ8 = constrain((error * 256) >> SYNC_PHASE_SHIFT, -limit, limit);
+  }
+  _phaseError = hasPhase ? phaseError : intervalError;
+
+  // LOCK DETECTION
+  // While stopped there is no phase to compare, so a steady period counts
+  if (_periodQ8 && abs(_phaseError) <= SYNC_LOCK_WINDOW_US)
+  {
+    _outWindow = 0;
+    if (_inWindow < SYNC_LOCK_PULSES)
+      _inWindow++;
+    if (_inWindow >= SYNC_LOCK_PULSES)
+      _locked = true;
+  }
+  else
+  {
+    _inWindow = 0;
+    if (_outWindow < SYNC_UNLOCK_PULSES)
+      _outWindow++;
+    if (_outWindow >= SYNC_UNLOCK_PULSES)
+      _locked = false;
+  }
+}
+
+// The period is kept, so playback freewheels at the last tempo
+void ClockSync::checkTimeout()
+{
+  if (_havePulse && micros() - _lastPulseTime > SYNC_TIMEOUT_MS * 1000UL)
+  {
+    _havePulse = false;
+    _locked = false;
+    _inWindow = 0;
+    _correctionQ8 = 0;
+  }
+}
+
+int ClockSync::_pulsesPerQuarter() const
+{
+  return (_source == CLOCK_PULSE_IN) ? CLOCK_PULSE_IN_PPQN : 24;
+}
+
+int ClockSync::getTicksPerPulse() const
+{
+  return PPQN / _pulsesPerQuarter();
+}
+
+uint32_t ClockSync::getTickPeriodQ8() const
+{
+  if (_source == CLOCK_INTERNAL || _periodQ8 == 0)
+    return 0;
+  return (uint32_t)((int32_t)_periodQ8 + _correctionQ8) / getTicksPerPulse();
+}
+
+SyncStatus ClockSync::getStatus() const
+{
+  if (_source == CLOCK_INTERNAL)
+    return SYNC_OFF;
+  return _locked ? SYNC_LOCKED : SYNC_SEARCHING;
+}
+
+int ClockSync::getCentiBPM() const
+{
+  if (_periodQ8 == 0)
+    return 0;
+  // 60e6 us * 100 * 256 / (period * pulses per quarter)
+  return (int)(1536000000000ULL / ((uint64_t)_periodQ8 * _pulsesPerQuarter()));
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "SpscQueue.h"
+#include "Model/SequencerModel.h"
+
+enum SyncEventType
+{
+  SYNC_PULSE, // One clock pulse (24 PPQN for MIDI)
+  SYNC_START, // MIDI Start or Continue
+  SYNC_STOP,  // MIDI Stop
+};
+
+struct SyncEvent
+{
+  uint32_t time; // micros() the pulse or message arrived
+  uint8_t type;  // SyncEventType
+};
+
+enum SyncStatus
+{
+  SYNC_OFF,       // Internal clock
+  SYNC_SEARCHING, // Following, but not (or no longer) in phase
+  SYNC_LOCKED,
+};
+
+// External clock input and the PLL that follows it.
+// Pulse edges arrive from the GPIO interrupt, MIDI clock from the USB host
+// MIDI handlers (called from MIDIDevice::read() in loop()); only the
+// selected source queues anything. The PLL itself runs in loop(), next to
+// the renderer that feeds it the phase of each pulse.
+// USB host MIDI is only parsed in read(), so a MIDI pulse is stamped up to
+// one loop() pass after it arrived. With the display sending every pass
+// that lag follows as a phase offset of about half a millisecond.
+class ClockSync
+{
+public:
+  ClockSync();
+  void begin(); // Attaches the pulse input interrupt
+
+  // Selecting a source restarts the PLL from scratch
+  void setSource(ClockSource source);
+  ClockSource getSource() const { return (ClockSource)_source; }
+
+  // Pops the next pulse or transport message.
+  // Returns false if empty.
+  bool getNextEvent(SyncEvent &event);
+
+  // --- PLL (loop) ---
+  // hasPhase: a tick was rendered for this pulse, and phaseError is the
+  // pulse time minus that tick's time (positive: the input is behind us)
+  void pulse(uint32_t time, bool hasPhase, int32_t phaseError);
+  void checkTimeout(); // Unlocks when the input has gone quiet
+
+  // Internal ticks per input pulse
+  int getTicksPerPulse() const;
+  // Tick period to render with, in 1/256 us. 0 until the period is known.
+  uint32_t getTickPeriodQ8() const;
+
+  SyncStatus getStatus() const;
+  int getCentiBPM() const; // Measured input tempo, 0 if unknown
+  int32_t getPhaseError() const { return _phaseError; }
+
+  static void onPulse(); // GPIO ISR
+  static void onMidiClock();
+  static void onMidiStart();
+  static void onMidiStop();
+
+private:
+  static ClockSync *_instance;
+  volatile uint8_t _source; // ClockSource
+
+  // INPUT -> loop()
+  SpscQueue<SyncEvent, SYNC_EVENT_QUEUE_SIZE> _events;
+
+  // PLL STATE (loop)
+  bool _havePulse;
+  uint32_t _lastPulseTime;
+  uint32_t _periodQ8;    // Filtered pulse period, 1/256 us
+  int32_t _correctionQ8; // Phase term added to the period
+  int32_t _phaseError;   // Last measured, us
+  uint8_t _inWindow;     // Consecutive pulses inside SYNC_LOCK_WINDOW_US
+  uint8_t _outWindow;    // Consecutive pulses outside it
+  bool _locked;
+
+  void _push(ClockSource from, SyncEventType type);
+  void _reset();
+  int _pulsesPerQuarter() const;
+};
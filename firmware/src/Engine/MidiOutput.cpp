@@ -0,0 +1,130 @@
+#include "MidiOutput.h"
+#include "Profiler.h"
+
+#ifdef MIDI_OUT
+
+MidiOutput *MidiOutput::_instance = nullptr;
+
+MidiOutput::MidiOutput()
+{
+  _instance = this;
+  _drops = 0;
+}
+
+void MidiOutput::begin()
+{
+  attachInterruptVector(IRQ_SOFTWARE, onSend);
+  NVIC_SET_PRIORITY(IRQ_SOFTWARE, MIDI_IRQ_PRIORITY);
+  NVIC_ENABLE_IRQ(IRQ_SOFTWARE);
+}
+
+// -------------------------------------------------------------------------
+// ISR: QUEUE
+// -------------------------------------------------------------------------
+void MidiOutput::queueRealTime(uint8_t status, uint32_t time)
+{
+  MidiMessage message;
+  message.time = time;
+  message.status = status;
+  message.data1 = 0;
+  message.data2 = 0;
+  _push(message);
+}
+
+void MidiOutput::queueSongPosition(uint16_t beats, uint32_t time)
+{
+  MidiMessage message;
+  message.time = time;
+  message.status = MIDI_SONG_POSITION;
+  message.data1 = beats & 0x7F;
+  message.data2 = (beats >> 7) & 0x7F;
+  _push(message);
+}
+
+void MidiOutput::queueNote(uint8_t status, uint8_t channel, uint8_t note, uint8_t velocity, uint32_t time)
+{
+  MidiMessage message;
+  message.time = time;
+  message.status = status | ((channel - 1) & 0x0F);
+  message.data1 = note;
+  message.data2 = velocity;
+  _push(message);
+}
+
+// Pending an interrupt that is already pending is a no-op, so a burst of
+// messages from one tick is sent in one go
+void MidiOutput::_push(const MidiMessage &message)
+{
+  if (!_queue.push(message))
+    _drops++;
+  NVIC_SET_PENDING(IRQ_SOFTWARE);
+}
+
+// -------------------------------------------------------------------------
+// SOFTWARE INTERRUPT: SEND
+// -------------------------------------------------------------------------
+void MidiOutput::onSend()
+{
+  if (_instance)
+    _instance->_flush();
+}
+
+void MidiOutput::_flush()
+{
+  MidiMessage message;
+  bool sent = false;
+  while (_queue.pop(message))
+  {
+    _send(message);
+    sent = true;
+  }
+  if (sent)
+    usbMIDI.send_now();
+}
+
+// The only send from loop(). Masking the interrupt keeps a single
+// consumer on the queue and a single caller into usbMIDI.
+void MidiOutput::sendRealTimeNow(uint8_t status)
+{
+  NVIC_DISABLE_IRQ(IRQ_SOFTWARE);
+  _flush();
+  MidiMessage message;
+  message.time = micros();
+  message.status = status;
+  message.data1 = 0;
+  message.data2 = 0;
+  _send(message);
+  usbMIDI.send_now();
+  NVIC_ENABLE_IRQ(IRQ_SOFTWARE);
+}
+
+void MidiOutput::_send(const MidiMessage &message)
+{
+  uint8_t channel = (message.status & 0x0F) + 1;
+  switch (message.status & 0xF0)
+  {
+  case MIDI_NOTE_ON:
+    usbMIDI.sendNoteOn(message.data1, message.data2, channel);
+    // A note's time is when its gate was written: this is the skew
+    PROFILE_MICROS(PROF_MIDI_SKEW, micros() - message.time);
+    return;
+  case MIDI_NOTE_OFF:
+    usbMIDI.sendNoteOff(message.data1, message.data2, channel);
+    PROFILE_MICROS(PROF_MIDI_SKEW, micros() - message.time);
+    return;
+  }
+
+  if (message.status == MIDI_SONG_POSITION)
+    usbMIDI.sendSongPosition(message.data1 | (message.data2 << 7));
+  else
+    usbMIDI.sendRealTime(message.status);
+
+  PROFILE_MICROS(PROF_MIDI_LATENCY, micros() - message.time);
+#ifdef MIDI_CLOCK_LOG
+  // Due and sent times, for jitter analysis on the host
+  if (message.status == MIDI_CLOCK)
+    Serial.printf("MIDI CLK %lu %lu\n", (unsigned long)message.time, (unsigned long)micros());
+#endif
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "SpscQueue.h"
+
+// MIDI status bytes
+#define MIDI_CLOCK 0xF8
+#define MIDI_START 0xFA
+#define MIDI_CONTINUE 0xFB
+#define MIDI_STOP 0xFC
+#define MIDI_SONG_POSITION 0xF2
+#define MIDI_NOTE_OFF 0x80 // Channel voice: low nibble is channel - 1
+#define MIDI_NOTE_ON 0x90
+
+struct MidiMessage
+{
+  uint32_t time; // micros() the message was due
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+// USB device MIDI out. The clock ISR queues messages at the moment they
+// are due and pends the software interrupt, which sends them and pushes
+// them out with send_now() once the clock ISR returns. It runs below the
+// clock (MIDI_IRQ_PRIORITY), so a send never holds off a tick, and never
+// waits on loop() or for the USB stack to fill a packet.
+class MidiOutput
+{
+public:
+  MidiOutput();
+  void begin(); // Attaches the send interrupt
+
+  // ISR side (single producer). A full queue drops the message.
+  void queueRealTime(uint8_t status, uint32_t time);
+  void queueSongPosition(uint16_t beats, uint32_t time); // beats: 16th notes
+  // status: MIDI_NOTE_ON or MIDI_NOTE_OFF; channel 1-16
+  void queueNote(uint8_t status, uint8_t channel, uint8_t note, uint8_t velocity, uint32_t time);
+
+  // loop() side. With the send interrupt masked, sends what is queued,
+  // then status (Stop must follow the last clock, and the ISR has nothing
+  // left to queue).
+  void sendRealTimeNow(uint8_t status);
+
+  uint32_t getDropCount() const { return _drops; }
+
+private:
+  static MidiOutput *_instance;
+  SpscQueue<MidiMessage, MIDI_OUT_QUEUE_SIZE> _queue;
+  volatile uint32_t _drops;
+
+  void _push(const MidiMessage &message);
+  void _flush();
+  void _send(const MidiMessage &message);
+  static void onSend();
+};
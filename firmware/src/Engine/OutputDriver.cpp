@@ -3,29 +3,74 @@
 
 void OutputDriver::init()
 {
+  _numPorts = 0;
+
   for (int i = 0; i < NUM_TRACKS; i++)
   {
     pinMode(OUTPUT_MAP[i], OUTPUT);
     digitalWrite(OUTPUT_MAP[i], TRIGGER_OFF);
+
+    // Group the pins by port so one register write covers all of them
+#if TRIGGER_ON == HIGH
+    volatile uint32_t *onReg = portSetRegister(OUTPUT_MAP[i]);
+    volatile uint32_t *offReg = portClearRegister(OUTPUT_MAP[i]);
+#else
+    volatile uint32_t *onReg = portClearRegister(OUTPUT_MAP[i]);
+    volatile uint32_t *offReg = portSetRegister(OUTPUT_MAP[i]);
+#endif
+    uint32_t bit = digitalPinToBitMask(OUTPUT_MAP[i]);
+
+    int p = 0;
+    while (p < _numPorts && _ports[p].onReg != onReg)
+      p++;
+    if (p == _numPorts)
+    {
+      _ports[p].onReg = onReg;
+      _ports[p].offReg = offReg;
+      _ports[p].allBits = 0;
+      _numPorts++;
+    }
+    _ports[p].allBits |= bit;
+
+    _trackPort[i] = p;
+    _trackBit[i] = bit;
   }
 }
 
 void OutputDriver::setTriggers(uint16_t mask)
 {
-  for (int i = 0; i < NUM_TRACKS; i++)
-  {
-    // Check if bit 'i' is set
-    if ((mask >> i) & 1)
-    {
-      digitalWrite(OUTPUT_MAP[i], TRIGGER_ON);
-    }
-  }
+  _writeHardware(mask, true);
+}
+
+void OutputDriver::clearTriggers(uint16_t mask)
+{
+  _writeHardware(mask, false);
 }
 
 void OutputDriver::clearAllTriggers()
 {
-  for (int i = 0; i < NUM_TRACKS; i++)
+  // Precomputed, so this is just the back-to-back register writes
+  for (int p = 0; p < _numPorts; p++)
+    *_ports[p].offReg = _ports[p].allBits;
+}
+
+// Builds every port word first, then writes them back to back so the
+// channel-to-channel skew is a few bus cycles instead of 8 digitalWrite()s
+void OutputDriver::_writeHardware(uint16_t mask, bool state)
+{
+  uint32_t portBits[NUM_TRACKS] = {0};
+
+  mask &= (1 << NUM_TRACKS) - 1;
+  while (mask)
   {
-    digitalWrite(OUTPUT_MAP[i], TRIGGER_OFF);
+    int t = __builtin_ctz(mask);
+    portBits[_trackPort[t]] |= _trackBit[t];
+    mask &= mask - 1;
+  }
+
+  for (int p = 0; p < _numPorts; p++)
+  {
+    if (portBits[p])
+      *(state ? _ports[p].onReg : _ports[p].offReg) = portBits[p];
   }
-}
\ No newline at end of file
+}
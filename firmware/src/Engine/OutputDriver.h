@@ -5,14 +5,34 @@
 class OutputDriver
 {
 public:
+  // Configures the pins and precomputes the port/bit map for fast writes
   void init();
 
   // Turns specific pins HIGH based on the mask
   void setTriggers(uint16_t trackMask);
 
+  // Turns specific pins LOW based on the mask
+  void clearTriggers(uint16_t trackMask);
+
   // Turns ALL trigger pins LOW
   void clearAllTriggers();
 
 private:
+  // The trigger pins are spread over several GPIO ports. Each port gets
+  // one write to its atomic SET or CLEAR register per update.
+  struct GpioPort
+  {
+    volatile uint32_t *onReg;  // Register that drives a bit to TRIGGER_ON
+    volatile uint32_t *offReg; // Register that drives a bit to TRIGGER_OFF
+    uint32_t allBits;          // Every trigger bit on this port
+  };
+
+  GpioPort _ports[NUM_TRACKS];
+  uint8_t _numPorts;
+
+  // Per track: which port entry and which bit within it
+  uint8_t _trackPort[NUM_TRACKS];
+  uint32_t _trackBit[NUM_TRACKS];
+
   void _writeHardware(uint16_t mask, bool state);
-};
\ No newline at end of file
+};
@@ -0,0 +1,106 @@
+#include "GptTimer.h"
+
+#define GPT_TICKS_PER_US 24
+
+const GptTimer::Registers GptTimer::_registers[2] = {
+    {&GPT1_CR, &GPT1_PR, &GPT1_SR, &GPT1_IR, &GPT1_OCR1},
+    {&GPT2_CR, &GPT2_PR, &GPT2_SR, &GPT2_IR, &GPT2_OCR1},
+};
+GptTimer *GptTimer::_timers[2] = {nullptr, nullptr};
+
+GptTimer::GptTimer()
+{
+  _module = -1;
+  _priority = 128;
+  _callback = nullptr;
+}
+
+bool GptTimer::begin(void (*callback)(), uint32_t us)
+{
+  if (_module < 0)
+  {
+    int index = (_timers[0] == nullptr) ? 0 : 1;
+    if (_timers[index] != nullptr)
+      return false;
+    _timers[index] = this;
+    _module = index;
+    _setup();
+  }
+
+  const Registers &r = _registers[_module];
+  _callback = callback;
+  uint32_t ticks = us * GPT_TICKS_PER_US;
+
+  // Restart mode: the count returns to 0 on reaching OCR1, and any write
+  // to OCR1 restarts it from 0 as well
+  *r.ocr1 = ticks - 1;
+  if (!(*r.cr & GPT_CR_EN))
+  {
+    *r.sr = GPT_SR_OF1;
+    *r.ir = GPT_IR_OF1IE;
+    *r.cr |= GPT_CR_EN; // ENMOD: starts from 0
+  }
+  return true;
+}
+
+void GptTimer::end()
+{
+  if (_module < 0)
+    return;
+  const Registers &r = _registers[_module];
+  *r.cr &= ~GPT_CR_EN;
+  *r.ir = 0;
+  *r.sr = GPT_SR_OF1;
+}
+
+void GptTimer::_setup()
+{
+  IRQ_NUMBER_t irq;
+  if (_module == 0)
+  {
+    CCM_CCGR1 |= CCM_CCGR1_GPT1_BUS(CCM_CCGR_ON) | CCM_CCGR1_GPT1_SERIAL(CCM_CCGR_ON);
+    irq = IRQ_GPT1;
+    attachInterruptVector(irq, onGpt1);
+  }
+  else
+  {
+    CCM_CCGR0 |= CCM_CCGR0_GPT2_BUS(CCM_CCGR_ON) | CCM_CCGR0_GPT2_SERIAL(CCM_CCGR_ON);
+    irq = IRQ_GPT2;
+    attachInterruptVector(irq, onGpt2);
+  }
+
+  const Registers &r = _registers[_module];
+  *r.cr = 0;
+  *r.ir = 0;
+  *r.pr = 0;
+  *r.sr = 0x3F;
+  *r.cr = GPT_CR_CLKSRC(1) | GPT_CR_ENMOD; // Peripheral clock, restart mode
+
+  NVIC_SET_PRIORITY(irq, _priority);
+  NVIC_ENABLE_IRQ(irq);
+}
+
+// -------------------------------------------------------------------------
+// COMPARE INTERRUPT
+// -------------------------------------------------------------------------
+void GptTimer::onGpt1()
+{
+  if (_timers[0])
+    _timers[0]->_handleCompare();
+}
+
+void GptTimer::onGpt2()
+{
+  if (_timers[1])
+    _timers[1]->_handleCompare();
+}
+
+void GptTimer::_handleCompare()
+{
+  const Registers &r = _registers[_module];
+  *r.sr = GPT_SR_OF1;
+  // Read back: the clear has to land before the interrupt returns, or it
+  // fires a second time
+  (void)*r.sr;
+  _callback();
+}
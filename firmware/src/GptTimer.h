@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+
+// IntervalTimer look-alike on the two general purpose timers (GPT1, GPT2).
+// Every IntervalTimer shares the PIT interrupt, and with it the clock's
+// NVIC priority. A GptTimer has an interrupt of its own, so background
+// refresh work can run below the clock and never hold off a tick.
+// Both count the 24MHz peripheral clock, like the PIT. Calling begin() from
+// the callback restarts the count, so every period can be different.
+class GptTimer
+{
+public:
+  GptTimer();
+
+  // Claims the next free GPT on first use. Returns false if both are taken.
+  bool begin(void (*callback)(), uint32_t us);
+  void end();
+
+  // NVIC priority, lower number wins (the PIT runs at 128). Set before the
+  // first begin().
+  void priority(uint8_t priority) { _priority = priority; }
+
+private:
+  struct Registers
+  {
+    volatile uint32_t *cr;
+    volatile uint32_t *pr;
+    volatile uint32_t *sr;
+    volatile uint32_t *ir;
+    volatile uint32_t *ocr1;
+  };
+  static const Registers _registers[2];
+  static GptTimer *_timers[2];
+
+  int8_t _module; // Index into _timers, -1 until claimed
+  uint8_t _priority;
+  void (*volatile _callback)();
+
+  void _setup();
+  void _handleCompare();
+  static void onGpt1();
+  static void onGpt2();
+};
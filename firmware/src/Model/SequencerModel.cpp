@@ -1,29 +1,43 @@
 #include "SequencerModel.h"
 
-// CONSTANTS FOR 96 PPQN
-// 96 pulses per quarter note
-// 16th note = 1/4 of a quarter = 24 ticks
-#define TICKS_PER_STEP 24
+// GM drum map: kick, snare, closed hat, open hat, clap, low tom, high tom,
+// crash
+static const uint8_t DEFAULT_MIDI_NOTES[NUM_TRACKS] = {36, 38, 42, 46, 39, 45, 50, 49};
 
 SequencerModel::SequencerModel()
 {
-  _bpm = 120;
+  _centiBPM = 12000;
 #ifdef DEFAULT_BPM
-  _bpm = DEFAULT_BPM;
+  _centiBPM = DEFAULT_BPM * 100;
 #endif
 
   _playing = false;
   _currentStep = 0;
   _currentTick = 0; // Init 96 PPQN counter
 
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    _gateWidthMs[t] = PULSE_WIDTH_MS;
+    _midiNote[t] = DEFAULT_MIDI_NOTES[t];
+    _midiChannel[t] = MIDI_NOTE_CHANNEL;
+  }
+  for (int v = 0; v < NUM_VERSIONS; v++)
+    _versions[v] = 0;
+
   _playMode = MODE_PATTERN_LOOP;
   currentViewPatternID = 0;
   activeTrackID = 0;
 
   _quantizationMode = Q_BAR;
+  _clockSource = CLOCK_INTERNAL;
   _playingPatternID = 0;
   _nextPatternID = 0;
 
+  _journalHead = 0;
+  _undoCount = 0;
+  _redoCount = 0;
+  _droppedEdits = 0;
+
   _playlistLength = 1;
   _playlistCursor = 0;
   for (int i = 0; i < MAX_SONG_LENGTH; i++)
@@ -34,48 +48,131 @@ SequencerModel::SequencerModel()
     for (int t = 0; t < NUM_TRACKS; t++)
     {
       _patternPool[p].trackSwing[t] = 0; // Default: 0 (Straight / 50%)
-      for (int s = 0; s < NUM_STEPS; s++)
-      {
-        _patternPool[p].steps[t][s] = false;
-      }
+      _patternPool[p].trackSteps[t] = 0;
     }
+    for (int s = 0; s < NUM_STEPS; s++)
+      _patternPool[p].stepMask[s] = 0;
+    _compileSwing(_patternPool[p]);
   }
 }
 
 // -------------------------------------------------------------------------
 // TEMPO
 // -------------------------------------------------------------------------
+// Stored in hundredths so the tempo pot can sweep between whole BPMs
 void SequencerModel::setBPM(int bpm)
 {
-  if (bpm < 10)
-    bpm = 10;
-  if (bpm > 300)
-    bpm = 300;
-  _bpm = bpm;
+  setCentiBPM(bpm * 100);
+}
+
+void SequencerModel::setCentiBPM(int centiBPM)
+{
+  if (centiBPM < 1000)
+    centiBPM = 1000;
+  if (centiBPM > 30000)
+    centiBPM = 30000;
+  if (centiBPM == _centiBPM)
+    return;
+  _centiBPM = centiBPM;
+  _touch(VERSION_TRANSPORT);
+}
+
+int SequencerModel::getBPM() const { return (_centiBPM + 50) / 100; }
+int SequencerModel::getCentiBPM() const { return _centiBPM; }
+
+void SequencerModel::setClockSource(ClockSource source)
+{
+  if (source == _clockSource)
+    return;
+  _clockSource = source;
+  _touch(VERSION_TRANSPORT);
+}
+
+// -------------------------------------------------------------------------
+// GATES
+// -------------------------------------------------------------------------
+// Single byte per track, so the ISR can read it at any time without the
+// edit queue
+void SequencerModel::setTrackGateWidth(int trackID, uint8_t widthMs)
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return;
+  if (widthMs < 1)
+    widthMs = 1;
+  if (widthMs > MAX_PULSE_WIDTH_MS)
+    widthMs = MAX_PULSE_WIDTH_MS;
+  _gateWidthMs[trackID] = widthMs;
+}
+
+uint8_t SequencerModel::getTrackGateWidth(int trackID) const
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return PULSE_WIDTH_MS;
+  return _gateWidthMs[trackID];
+}
+
+// -------------------------------------------------------------------------
+// MIDI NOTES
+// -------------------------------------------------------------------------
+// Same rule as the gate widths: one byte each, read by the clock ISR
+void SequencerModel::setTrackMidiNote(int trackID, uint8_t note)
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return;
+  _midiNote[trackID] = note & 0x7F;
+}
+
+uint8_t SequencerModel::getTrackMidiNote(int trackID) const
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return 0;
+  return _midiNote[trackID];
+}
+
+void SequencerModel::setTrackMidiChannel(int trackID, uint8_t channel)
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return;
+  _midiChannel[trackID] = constrain(channel, 1, 16);
 }
 
-int SequencerModel::getBPM() const { return _bpm; }
+uint8_t SequencerModel::getTrackMidiChannel(int trackID) const
+{
+  if (trackID < 0 || trackID >= NUM_TRACKS)
+    return MIDI_NOTE_CHANNEL;
+  return _midiChannel[trackID];
+}
 
 // -------------------------------------------------------------------------
 // TRANSPORT
 // -------------------------------------------------------------------------
 void SequencerModel::play()
+{
+  _queueEdit(OP_PLAY, currentViewPatternID);
+}
+
+void SequencerModel::stop()
+{
+  _queueEdit(OP_STOP, currentViewPatternID);
+}
+
+void SequencerModel::_applyPlay(int patternID)
 {
   _playing = true;
   // On Start, sync everything
-  _playingPatternID = currentViewPatternID;
-  _nextPatternID = currentViewPatternID;
+  _playingPatternID = patternID;
+  _nextPatternID = patternID;
 }
 
-void SequencerModel::stop()
+void SequencerModel::_applyStop(int patternID)
 {
   _playing = false;
   _currentStep = 0;
   _currentTick = 0;
   _playlistCursor = 0;
   // On Stop, sync everything
-  _playingPatternID = currentViewPatternID;
-  _nextPatternID = currentViewPatternID;
+  _playingPatternID = patternID;
+  _nextPatternID = patternID;
 }
 
 // -------------------------------------------------------------------------
@@ -91,6 +188,12 @@ void SequencerModel::setPattern(int patternID)
   // Update the UI immediately
   currentViewPatternID = patternID;
 
+  // The audio side follows at the next tick boundary
+  _queueEdit(OP_SELECT_PATTERN, patternID);
+}
+
+void SequencerModel::_applySelectPattern(int patternID)
+{
   // Update the Waiting Room
   _nextPatternID = patternID;
 
@@ -120,16 +223,21 @@ void SequencerModel::prevPattern()
 void SequencerModel::setQuantization(QuantizationMode mode)
 {
   _quantizationMode = mode;
+  _touch(VERSION_TRANSPORT);
 }
 
 void SequencerModel::applyPendingPattern()
 {
+  if (_playingPatternID == _nextPatternID)
+    return;
   _playingPatternID = _nextPatternID;
+  _touch(VERSION_TRANSPORT);
 }
 
 void SequencerModel::setPlayMode(PlayMode mode)
 {
   _playMode = mode;
+  _touch(VERSION_TRANSPORT);
 }
 
 // -------------------------------------------------------------------------
@@ -141,7 +249,30 @@ void SequencerModel::setTrackSwing(int trackID, uint8_t swingValue)
     return;
   if (swingValue > 100)
     swingValue = 100; // Cap at 100% (though logic maps it to 75% delay)
-  _patternPool[currentViewPatternID].trackSwing[trackID] = swingValue;
+  _queueEdit(OP_SET_SWING, currentViewPatternID, trackID, swingValue);
+}
+
+void SequencerModel::_applySwing(int patternID, int trackID, uint8_t swingValue)
+{
+  Pattern &p = _patternPool[patternID];
+  if (p.trackSwing[trackID] == swingValue)
+    return;
+
+  // A pot sweep is one action: fold it into the record already on top
+  bool coalesce = false;
+  if (_undoCount > 0 && _redoCount == 0)
+  {
+    const EditRecord &top = _journal[(_journalHead + UNDO_DEPTH - 1) % UNDO_DEPTH];
+    coalesce = (top.flags & EDIT_SWING) && top.patternID == patternID && top.track == trackID;
+  }
+  if (!coalesce)
+  {
+    EditRecord record = {(uint8_t)patternID, (uint8_t)trackID, EDIT_SWING, p.trackSwing[trackID], 0};
+    _recordEdit(record);
+  }
+
+  p.trackSwing[trackID] = swingValue;
+  _compileSwing(p);
 }
 
 uint8_t SequencerModel::getTrackSwing(int trackID) const
@@ -173,19 +304,40 @@ uint8_t SequencerModel::getPlaylistPattern(int slotIndex) const
 
 void SequencerModel::setPlaylistPattern(int slotIndex, uint8_t patternID)
 {
-  if (slotIndex < 0 || slotIndex >= _playlistLength)
+  if (slotIndex < 0 || slotIndex >= MAX_SONG_LENGTH)
     return;
   if (patternID >= MAX_PATTERNS)
     patternID = 0;
-  _playlist[slotIndex] = patternID;
+  _queueEdit(OP_SET_SLOT, patternID, slotIndex);
 }
 
 void SequencerModel::insertPlaylistSlot(int slotIndex, uint8_t patternID)
 {
-  if (_playlistLength >= MAX_SONG_LENGTH)
-    return;
   if (slotIndex < 0)
     slotIndex = 0;
+  if (slotIndex > MAX_SONG_LENGTH)
+    slotIndex = MAX_SONG_LENGTH;
+  _queueEdit(OP_INSERT_SLOT, patternID, slotIndex);
+}
+
+void SequencerModel::deletePlaylistSlot(int slotIndex)
+{
+  if (slotIndex < 0 || slotIndex >= MAX_SONG_LENGTH)
+    return;
+  _queueEdit(OP_DELETE_SLOT, 0, slotIndex);
+}
+
+void SequencerModel::_applySetSlot(int slotIndex, uint8_t patternID)
+{
+  if (slotIndex >= _playlistLength)
+    return;
+  _playlist[slotIndex] = patternID;
+}
+
+void SequencerModel::_applyInsertSlot(int slotIndex, uint8_t patternID)
+{
+  if (_playlistLength >= MAX_SONG_LENGTH)
+    return;
   if (slotIndex > _playlistLength)
     slotIndex = _playlistLength;
   for (int i = _playlistLength; i > slotIndex; i--)
@@ -194,11 +346,11 @@ void SequencerModel::insertPlaylistSlot(int slotIndex, uint8_t patternID)
   _playlistLength++;
 }
 
-void SequencerModel::deletePlaylistSlot(int slotIndex)
+void SequencerModel::_applyDeleteSlot(int slotIndex)
 {
   if (_playlistLength <= 1)
     return;
-  if (slotIndex < 0 || slotIndex >= _playlistLength)
+  if (slotIndex >= _playlistLength)
     return;
   for (int i = slotIndex; i < _playlistLength - 1; i++)
     _playlist[i] = _playlist[i + 1];
@@ -212,42 +364,219 @@ void SequencerModel::deletePlaylistSlot(int slotIndex)
 // -------------------------------------------------------------------------
 void SequencerModel::toggleStep(int track, int step)
 {
-  if (track >= NUM_TRACKS || step >= NUM_STEPS)
+  if (track < 0 || track >= NUM_TRACKS || step < 0 || step >= NUM_STEPS)
     return;
-  bool current = _patternPool[currentViewPatternID].steps[track][step];
-  _patternPool[currentViewPatternID].steps[track][step] = !current;
+  _queueEdit(OP_TOGGLE_STEP, currentViewPatternID, track, step);
 }
 
 void SequencerModel::clearCurrentPattern()
 {
-  createSnapshot();
-  for (int t = 0; t < NUM_TRACKS; t++)
-    for (int s = 0; s < NUM_STEPS; s++)
-      _patternPool[currentViewPatternID].steps[t][s] = false;
+  _queueEdit(OP_CLEAR_PATTERN, currentViewPatternID);
 }
 
 void SequencerModel::clearTrack(int trackID)
 {
   if (trackID < 0 || trackID >= NUM_TRACKS)
     return;
-  createSnapshot();
-  for (int s = 0; s < NUM_STEPS; s++)
-    _patternPool[currentViewPatternID].steps[trackID][s] = false;
+  _queueEdit(OP_CLEAR_TRACK, currentViewPatternID, trackID);
+}
+
+void SequencerModel::_applyToggleStep(int patternID, int track, int step)
+{
+  EditRecord record = {(uint8_t)patternID, (uint8_t)track, 0, 0, (uint16_t)(1 << step)};
+  _recordEdit(record);
+  _flipSteps(_patternPool[patternID], track, 1 << step);
+}
+
+void SequencerModel::_applyClearPattern(int patternID)
+{
+  Pattern &p = _patternPool[patternID];
+  uint8_t flags = 0;
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    if (p.trackSteps[t] == 0)
+      continue;
+    // One record per track, grouped so that a single undo restores them all
+    EditRecord record = {(uint8_t)patternID, (uint8_t)t, flags, 0, p.trackSteps[t]};
+    _recordEdit(record);
+    _flipSteps(p, t, p.trackSteps[t]);
+    flags = EDIT_GROUPED;
+  }
+}
+
+void SequencerModel::_applyClearTrack(int patternID, int trackID)
+{
+  Pattern &p = _patternPool[patternID];
+  if (p.trackSteps[trackID] == 0)
+    return;
+  EditRecord record = {(uint8_t)patternID, (uint8_t)trackID, 0, 0, p.trackSteps[trackID]};
+  _recordEdit(record);
+  _flipSteps(p, trackID, p.trackSteps[trackID]);
+}
+
+// Keeps the row and the transposed column in step with each other
+void SequencerModel::_flipSteps(Pattern &p, int track, uint16_t bits)
+{
+  p.trackSteps[track] ^= bits;
+  uint8_t trackBit = (1 << track);
+  while (bits)
+  {
+    int s = __builtin_ctz(bits);
+    p.stepMask[s] ^= trackBit;
+    bits &= bits - 1;
+  }
 }
 
 // -------------------------------------------------------------------------
-// UNDO SYSTEM
+// UNDO SYSTEM (Delta Journal)
 // -------------------------------------------------------------------------
-void SequencerModel::createSnapshot()
+// Records live in a fixed ring: new edits overwrite the oldest ones and
+// discard anything that could have been redone.
+void SequencerModel::_recordEdit(const EditRecord &record)
 {
-  _undoBuffer = _patternPool[currentViewPatternID];
+  bool full = (_undoCount == UNDO_DEPTH);
+  _journal[_journalHead] = record;
+  _journalHead = (_journalHead + 1) % UNDO_DEPTH;
+  if (!full)
+    _undoCount++;
+  _redoCount = 0;
+
+  // The oldest record was just overwritten. If it started an action, the
+  // rest of that action can't be undone on its own: drop it too.
+  while (full && _undoCount > 1 &&
+         (_journal[(_journalHead + UNDO_DEPTH - _undoCount) % UNDO_DEPTH].flags & EDIT_GROUPED))
+    _undoCount--;
+}
+
+// Swaps the stored state with the pattern. Calling it twice is a no-op,
+// which is what makes the same record usable for undo and redo.
+void SequencerModel::_applyEdit(EditRecord &record)
+{
+  Pattern &p = _patternPool[record.patternID];
+  if (record.flags & EDIT_SWING)
+  {
+    uint8_t current = p.trackSwing[record.track];
+    p.trackSwing[record.track] = record.swing;
+    record.swing = current;
+    _compileSwing(p);
+  }
+  else
+  {
+    _flipSteps(p, record.track, record.stepBits);
+  }
 }
 
 void SequencerModel::undo()
 {
-  Pattern temp = _patternPool[currentViewPatternID];
-  _patternPool[currentViewPatternID] = _undoBuffer;
-  _undoBuffer = temp;
+  _queueEdit(OP_UNDO);
+}
+
+void SequencerModel::redo()
+{
+  _queueEdit(OP_REDO);
+}
+
+void SequencerModel::_applyUndo()
+{
+  while (_undoCount > 0)
+  {
+    _journalHead = (_journalHead + UNDO_DEPTH - 1) % UNDO_DEPTH;
+    _undoCount--;
+    _redoCount++;
+    EditRecord &record = _journal[_journalHead];
+    _applyEdit(record);
+    if (!(record.flags & EDIT_GROUPED))
+      break; // Reached the first record of the action
+  }
+}
+
+void SequencerModel::_applyRedo()
+{
+  while (_redoCount > 0)
+  {
+    _applyEdit(_journal[_journalHead]);
+    _journalHead = (_journalHead + 1) % UNDO_DEPTH;
+    _redoCount--;
+    _undoCount++;
+    // Keep going while the next record belongs to the same action
+    if (_redoCount == 0 || !(_journal[_journalHead].flags & EDIT_GROUPED))
+      break;
+  }
+}
+
+// -------------------------------------------------------------------------
+// EDIT HANDOFF (UI -> Engine)
+// -------------------------------------------------------------------------
+// Producer side (main loop). The engine drains the queue from loop() too,
+// once per update() pass, so waiting here for room would never end. It only
+// fills up if a single pass queues more than EDIT_QUEUE_SIZE - 1 edits; the
+// edit is then dropped and counted.
+void SequencerModel::_queueEdit(EditOp op, int patternID, int a, int b)
+{
+  PendingEdit edit = {(uint8_t)op, (uint8_t)patternID, (uint8_t)a, (uint8_t)b};
+  if (!_editQueue.push(edit))
+    _droppedEdits++;
+}
+
+// Consumer side (engine, between rendered ticks)
+void SequencerModel::applyPendingEdits()
+{
+  PendingEdit edit;
+  while (_editQueue.pop(edit))
+  {
+    switch (edit.op)
+    {
+    case OP_PLAY:
+      _applyPlay(edit.patternID);
+      _touch(VERSION_TRANSPORT);
+      break;
+    case OP_STOP:
+      _applyStop(edit.patternID);
+      _touch(VERSION_TRANSPORT);
+      _touch(VERSION_PLAYLIST); // Song cursor rewinds
+      break;
+    case OP_SELECT_PATTERN:
+      _applySelectPattern(edit.patternID);
+      _touch(VERSION_TRANSPORT);
+      break;
+    case OP_TOGGLE_STEP:
+      _applyToggleStep(edit.patternID, edit.a, edit.b);
+      _touch(VERSION_GRID);
+      break;
+    case OP_CLEAR_TRACK:
+      _applyClearTrack(edit.patternID, edit.a);
+      _touch(VERSION_GRID);
+      break;
+    case OP_CLEAR_PATTERN:
+      _applyClearPattern(edit.patternID);
+      _touch(VERSION_GRID);
+      break;
+    case OP_SET_SWING:
+      _applySwing(edit.patternID, edit.a, edit.b);
+      _touch(VERSION_GRID);
+      break;
+    case OP_UNDO:
+      _applyUndo();
+      _touch(VERSION_GRID);
+      break;
+    case OP_REDO:
+      _applyRedo();
+      _touch(VERSION_GRID);
+      break;
+    case OP_SET_SLOT:
+      _applySetSlot(edit.a, edit.patternID);
+      _touch(VERSION_PLAYLIST);
+      break;
+    case OP_INSERT_SLOT:
+      _applyInsertSlot(edit.a, edit.patternID);
+      _touch(VERSION_PLAYLIST);
+      break;
+    case OP_DELETE_SLOT:
+      _applyDeleteSlot(edit.a);
+      _touch(VERSION_PLAYLIST);
+      break;
+    }
+  }
 }
 
 // -------------------------------------------------------------------------
@@ -265,17 +594,23 @@ int SequencerModel::getPlayingPatternID() const
   }
 }
 
-uint16_t SequencerModel::getTriggersForStep(int patternID, int step)
+uint16_t SequencerModel::getTriggersForStep(int patternID, int step) const
 {
-  uint16_t mask = 0;
-  for (int t = 0; t < NUM_TRACKS; t++)
-  {
-    if (_patternPool[patternID].steps[t][step])
-    {
-      mask |= (1 << t);
-    }
-  }
-  return mask;
+  return _patternPool[patternID].stepMask[step];
+}
+
+uint16_t SequencerModel::getTrackSteps(int patternID, int trackID) const
+{
+  return _patternPool[patternID].trackSteps[trackID];
+}
+
+uint16_t SequencerModel::getFireMask(int patternID, int step, int tick) const
+{
+  // Swing never delays past MAX_SWING_TICKS, nothing fires later in a step
+  if (tick > MAX_SWING_TICKS)
+    return 0;
+  const Pattern &p = _patternPool[patternID];
+  return p.stepMask[step] & p.tickMask[step & 1][tick];
 }
 
 // NEW: 96 PPQN Advance Logic
@@ -303,9 +638,37 @@ bool SequencerModel::advanceTick()
         {
           _playlistCursor = 0;
         }
+        _touch(VERSION_PLAYLIST);
+        _touch(VERSION_TRANSPORT); // Playing pattern follows the cursor
       }
       return true; // Wrapped Bar
     }
   }
   return false;
+}
+
+// -------------------------------------------------------------------------
+// SCHEDULE COMPILATION
+// -------------------------------------------------------------------------
+void SequencerModel::_compileSwing(Pattern &p)
+{
+  uint8_t even[MAX_SWING_TICKS + 1] = {0};
+  uint8_t odd[MAX_SWING_TICKS + 1] = {0};
+
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    // Even steps are always on the grid
+    even[0] |= (1 << t);
+
+    // Apply delay only to ODD steps (the "ands" of the beat)
+    int targetTick = (p.trackSwing[t] * MAX_SWING_TICKS) / 100;
+    odd[targetTick] |= (1 << t);
+  }
+
+  // Byte-sized stores: the ISR sees either the old or the new mask per tick
+  for (int i = 0; i <= MAX_SWING_TICKS; i++)
+  {
+    p.tickMask[0][i] = even[i];
+    p.tickMask[1][i] = odd[i];
+  }
 }
\ No newline at end of file
@@ -1,11 +1,73 @@
 #pragma once
 #include <Arduino.h>
 #include "Config.h"
+#include "SpscQueue.h"
+
+// Packed storage: one bit per step, kept both row-wise and column-wise
+static_assert(NUM_STEPS <= 16, "trackSteps is a uint16_t per track");
+static_assert(NUM_TRACKS <= 8, "stepMask and tickMask are a uint8_t per step");
 
 struct Pattern
 {
-  bool steps[NUM_TRACKS][NUM_STEPS];
-  uint8_t trackSwing[NUM_TRACKS]; // 0 (50%) to 100 (75%)
+  uint16_t trackSteps[NUM_TRACKS]; // Bit s = step s is ON for this track
+  uint8_t stepMask[NUM_STEPS];     // Transposed: bit t = track t is ON at this step
+  uint8_t trackSwing[NUM_TRACKS];  // 0 (50%) to 100 (75%)
+
+  // Compiled Swing Schedule (derived from trackSwing, rebuilt on edit)
+  // Fire mask for (step, tick) is stepMask[step] & tickMask[step & 1][tick]
+  uint8_t tickMask[2][MAX_SWING_TICKS + 1]; // [even/odd step][tick] -> tracks due
+};
+
+// One reversible edit in the undo journal.
+// Applying a record swaps the pattern with the stored state, so the same
+// record serves for both undo and redo.
+enum EditFlags
+{
+  EDIT_SWING = 0x01,   // Swing record (otherwise a step record)
+  EDIT_GROUPED = 0x02, // Same user action as the record before it
+};
+
+struct EditRecord
+{
+  uint8_t patternID;
+  uint8_t track;
+  uint8_t flags;
+  uint8_t swing;     // Swing value to swap back in (EDIT_SWING)
+  uint16_t stepBits; // Steps to flip back (step records)
+};
+
+// An edit queued by the UI and applied by the engine between ticks
+enum EditOp
+{
+  OP_PLAY,
+  OP_STOP,
+  OP_SELECT_PATTERN,
+  OP_TOGGLE_STEP,
+  OP_CLEAR_TRACK,
+  OP_CLEAR_PATTERN,
+  OP_SET_SWING,
+  OP_UNDO,
+  OP_REDO,
+  OP_SET_SLOT,
+  OP_INSERT_SLOT,
+  OP_DELETE_SLOT
+};
+
+struct PendingEdit
+{
+  uint8_t op;
+  uint8_t patternID;
+  uint8_t a; // Track or playlist slot
+  uint8_t b; // Step or swing value
+};
+
+// Change tracking: one counter per area of state the view draws
+enum ModelVersion
+{
+  VERSION_TRANSPORT, // Play state, patterns playing/pending, mode, tempo
+  VERSION_GRID,      // Steps and swing of any pattern
+  VERSION_PLAYLIST,  // Playlist slots and song cursor
+  NUM_VERSIONS
 };
 
 enum PlayMode
@@ -22,11 +84,34 @@ enum QuantizationMode
   Q_INSTANT
 };
 
+// Where the tempo comes from
+enum ClockSource
+{
+  CLOCK_INTERNAL, // Tempo pot / BPM entry
+  CLOCK_MIDI_IN,  // USB host MIDI clock (24 PPQN) with Start/Stop
+  CLOCK_PULSE_IN, // Pulses on PIN_CLOCK_IN (CLOCK_PULSE_IN_PPQN)
+  NUM_CLOCK_SOURCES
+};
+
+// Threading: the public mutators below are called from loop(). Anything
+// playback depends on is only queued here. The engine applies the queue at
+// the start of every render pass, which always falls between two rendered
+// ticks, so no tick is rendered from a half-applied edit and nobody has to
+// disable interrupts.
 class SequencerModel
 {
 public:
   SequencerModel();
 
+  // --- EDIT HANDOFF ---
+  void applyPendingEdits(); // Engine side only
+  bool hasPendingEdits() const { return !_editQueue.isEmpty(); }
+  uint32_t getDroppedEditCount() const { return _droppedEdits; } // Queue was full
+
+  // --- CHANGE TRACKING ---
+  // Moves every time state in that area changes; compare, don't interpret
+  uint32_t getVersion(ModelVersion area) const { return _versions[area]; }
+
   // --- TRANSPORT ---
   void play();
   void stop();
@@ -70,11 +155,20 @@ public:
   void clearTrack(int trackId);
 
   // --- UNDO ---
-  void createSnapshot();
+  // Multi-level, across all patterns. Each call reverts one user action.
   void undo();
+  void redo();
+  bool canUndo() const { return _undoCount > 0; }
+  bool canRedo() const { return _redoCount > 0; }
 
   // --- ENGINE INTERFACE ---
-  uint16_t getTriggersForStep(int patternID, int step);
+  uint16_t getTriggersForStep(int patternID, int step) const;
+
+  // All 16 steps of one track as a bitmask (bit 0 = step 1)
+  uint16_t getTrackSteps(int patternID, int trackID) const;
+
+  // Tracks that fire at this exact tick of the step (swing applied)
+  uint16_t getFireMask(int patternID, int step, int tick) const;
   int getPlayingPatternID() const;
 
   // Returns TRUE if we wrapped a bar
@@ -85,11 +179,33 @@ public:
 
   // --- TEMPO ---
   void setBPM(int bpm);
-  int getBPM() const;
+  void setCentiBPM(int centiBPM); // 1/100 BPM (12050 = 120.5 BPM)
+  int getBPM() const;             // Rounded to the nearest whole BPM
+  int getCentiBPM() const;
+
+  void setClockSource(ClockSource source);
+  ClockSource getClockSource() const { return _clockSource; }
+
+  // --- GATES ---
+  // Trigger pulse length per output (1 - MAX_PULSE_WIDTH_MS)
+  void setTrackGateWidth(int trackID, uint8_t widthMs);
+  uint8_t getTrackGateWidth(int trackID) const;
+
+  // --- MIDI NOTES ---
+  // Sent alongside each output's gate (note 0-127, channel 1-16)
+  void setTrackMidiNote(int trackID, uint8_t note);
+  uint8_t getTrackMidiNote(int trackID) const;
+  void setTrackMidiChannel(int trackID, uint8_t channel);
+  uint8_t getTrackMidiChannel(int trackID) const;
 
 private:
   Pattern _patternPool[MAX_PATTERNS];
-  Pattern _undoBuffer;
+
+  // UNDO JOURNAL (Ring buffer of edit records)
+  EditRecord _journal[UNDO_DEPTH];
+  int _journalHead; // Next record to write (or redo)
+  int _undoCount;   // Records behind the head that can be undone
+  int _redoCount;   // Records from the head on that can be redone
 
   uint8_t _playlist[MAX_SONG_LENGTH];
   int _playlistLength;
@@ -102,9 +218,43 @@ private:
   int _currentTick; // 0 to 23 (for 16th notes at 96 PPQN)
 
   PlayMode _playMode;
-  int _bpm;
+  int _centiBPM;
+  ClockSource _clockSource;
+  uint8_t _gateWidthMs[NUM_TRACKS];
+  uint8_t _midiNote[NUM_TRACKS];
+  uint8_t _midiChannel[NUM_TRACKS];
+  uint32_t _versions[NUM_VERSIONS];
+
+  // UI -> Engine edit queue
+  SpscQueue<PendingEdit, EDIT_QUEUE_SIZE> _editQueue;
+  uint32_t _droppedEdits;
 
   QuantizationMode _quantizationMode;
   int _playingPatternID;
   int _nextPatternID;
+
+  void _touch(ModelVersion area) { _versions[area]++; }
+
+  // Schedule Compilation
+  void _compileSwing(Pattern &p);
+
+  // Edit Handoff
+  void _queueEdit(EditOp op, int patternID = 0, int a = 0, int b = 0);
+  void _applyPlay(int patternID);
+  void _applyStop(int patternID);
+  void _applySelectPattern(int patternID);
+  void _applyToggleStep(int patternID, int track, int step);
+  void _applyClearTrack(int patternID, int trackID);
+  void _applyClearPattern(int patternID);
+  void _applySwing(int patternID, int trackID, uint8_t swingValue);
+  void _applyUndo();
+  void _applyRedo();
+  void _applySetSlot(int slotIndex, uint8_t patternID);
+  void _applyInsertSlot(int slotIndex, uint8_t patternID);
+  void _applyDeleteSlot(int slotIndex);
+
+  // Edit Helpers
+  void _flipSteps(Pattern &p, int track, uint16_t bits);
+  void _recordEdit(const EditRecord &record);
+  void _applyEdit(EditRecord &record);
 };
\ No newline at end of file
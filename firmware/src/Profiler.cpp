@@ -0,0 +1,148 @@
+#include "Profiler.h"
+
+#ifdef PROFILE_MODE
+
+static const char *SECTION_NAMES[PROF_NUM_SECTIONS] = {
+    "CLK ISR",
+    "CLK RENDER",
+    "DISPLAY",
+    "OLED XFER",
+    "KEY SCAN",
+    "USB TASK",
+    "TRIG EDGE",
+    "LED LAG",
+    "LED BCM",
+    "INPUT LAG",
+    "UI CMD",
+    "MIDI LAG",
+    "NOTE SKEW",
+};
+
+static const char *SECTION_LABELS[PROF_NUM_SECTIONS] = {
+    "ISR",
+    "RNDR",
+    "DRAW",
+    "XFER",
+    "KEYS",
+    "USB",
+    "EDGE",
+    "LAG",
+    "BCM",
+    "IN",
+    "CMD",
+    "MIDI",
+    "SKEW",
+};
+
+ProfileStats Profiler::_stats[PROF_NUM_SECTIONS];
+void (*Profiler::_resetCallback)() = nullptr;
+
+void Profiler::init()
+{
+  // The core usually starts with the counter running, but don't rely on it
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  reset();
+}
+
+void Profiler::reset()
+{
+  // The ISR owns some sections, so this is the one place that blocks it
+  noInterrupts();
+  for (int s = 0; s < PROF_NUM_SECTIONS; s++)
+  {
+    memset(&_stats[s], 0, sizeof(ProfileStats));
+    _stats[s].minCycles = UINT32_MAX;
+  }
+  interrupts();
+}
+
+void Profiler::record(ProfileSection section, uint32_t cycles)
+{
+  ProfileStats &s = _stats[section];
+  s.count++;
+  s.totalCycles += cycles;
+  if (cycles < s.minCycles)
+    s.minCycles = cycles;
+  if (cycles > s.maxCycles)
+    s.maxCycles = cycles;
+
+  uint32_t us = cycles / (F_CPU_ACTUAL / 1000000);
+  int bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+  if (bucket >= PROFILE_BUCKETS)
+    bucket = PROFILE_BUCKETS - 1;
+  s.buckets[bucket]++;
+}
+
+void Profiler::recordEdge(uint32_t idealUs, uint32_t sampleUs, uint32_t sampleCycles)
+{
+  // Whole microseconds late at the sample, plus the cycles spent since
+  int32_t lateUs = (int32_t)(sampleUs - idealUs);
+  if (lateUs < 0)
+    lateUs = 0; // Never early by design; guard against a stale sample
+  uint32_t cycles = (uint32_t)lateUs * (F_CPU_ACTUAL / 1000000) + (ARM_DWT_CYCCNT - sampleCycles);
+  record(PROF_TRIGGER_EDGE, cycles);
+}
+
+const char *Profiler::getName(ProfileSection section)
+{
+  return SECTION_NAMES[section];
+}
+
+const char *Profiler::getLabel(ProfileSection section)
+{
+  return SECTION_LABELS[section];
+}
+
+void Profiler::serviceSerial()
+{
+  while (Serial.available())
+  {
+    int c = Serial.read();
+    if (c == 'p')
+      dump();
+    else if (c == 'r')
+    {
+      reset();
+      if (_resetCallback)
+        _resetCallback();
+      Serial.println("PROFILE: reset");
+    }
+  }
+}
+
+void Profiler::dump()
+{
+  Serial.printf("--- PROFILE (us, CPU %lu MHz) ---\n", (unsigned long)(F_CPU_ACTUAL / 1000000));
+  for (int i = 0; i < PROF_NUM_SECTIONS; i++)
+  {
+    ProfileSection section = (ProfileSection)i;
+    const ProfileStats &s = _stats[section];
+    if (s.count == 0)
+    {
+      Serial.printf("%-10s  no samples\n", getName(section));
+      continue;
+    }
+
+    Serial.printf("%-10s  n=%lu  min %.2f  avg %.2f  max %.2f\n",
+                  getName(section), (unsigned long)s.count,
+                  toMicros(s.minCycles),
+                  toMicros((uint32_t)(s.totalCycles / s.count)),
+                  toMicros(s.maxCycles));
+
+    // Histogram: "lower bound:count" for every non-empty bucket
+    Serial.print("           ");
+    for (int b = 0; b < PROFILE_BUCKETS; b++)
+    {
+      if (s.buckets[b] == 0)
+        continue;
+      if (b == 0)
+        Serial.printf(" <1:%lu", (unsigned long)s.buckets[b]);
+      else
+        Serial.printf(" %lu:%lu", 1UL << (b - 1), (unsigned long)s.buckets[b]);
+    }
+    Serial.println();
+  }
+}
+
+#endif
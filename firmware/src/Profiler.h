@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+
+// Uncomment this line to compile in the timing instrumentation
+// #define PROFILE_MODE
+
+// Measured sections. Each keeps its own min/max/mean and histogram.
+enum ProfileSection
+{
+  PROF_CLOCK_ISR,     // ClockEngine::_handleTick
+  PROF_CLOCK_RENDER,  // ClockEngine::update (lookahead rendering)
+  PROF_DISPLAY,       // DisplayManager::update (only passes that draw)
+  PROF_DISPLAY_XFER,  // One bounded slice of the OLED transfer
+  PROF_KEY_SCAN,      // KeyMatrix scan ISR (one row)
+  PROF_USB_TASK,      // myusb.Task()
+  PROF_TRIGGER_EDGE,  // Actual minus ideal time of each trigger rising edge
+  PROF_LED_LATENCY,   // Step boundary at the outputs to its LED frame latched
+  PROF_LED_REFRESH,   // StepLeds BCM refresh ISR
+  PROF_INPUT_LATENCY, // Key contact to manual trigger at the outputs
+  PROF_UI_DISPATCH,   // UIManager::handleCommand (table lookup + handler)
+  PROF_MIDI_LATENCY,  // MIDI message due to handed to USB (send_now)
+  PROF_MIDI_SKEW,     // Gate edge to its MIDI note handed to USB
+  PROF_NUM_SECTIONS
+};
+
+// Histogram buckets are powers of two in microseconds:
+// [0] < 1us, [1] 1-2us, [2] 2-4us ... [15] >= 16ms
+#define PROFILE_BUCKETS 16
+
+struct ProfileStats
+{
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t buckets[PROFILE_BUCKETS];
+};
+
+// Cycle-accurate timing built on the ARM DWT cycle counter (CYCCNT).
+// Each section is written from one context only (the clock sections from
+// the ISR, the rest from loop()), so recording never disables interrupts.
+// Readers may see a count and a total from slightly different moments.
+class Profiler
+{
+public:
+  static void init();
+  static void reset();
+
+  static void record(ProfileSection section, uint32_t cycles);
+  static void recordMicros(ProfileSection section, uint32_t us) { record(section, us * (F_CPU_ACTUAL / 1000000)); }
+
+  // idealUs: when the edge should have happened (micros() timestamp)
+  // sampleUs/sampleCycles: micros() and CYCCNT read together before the write
+  static void recordEdge(uint32_t idealUs, uint32_t sampleUs, uint32_t sampleCycles);
+
+  static const ProfileStats &get(ProfileSection section) { return _stats[section]; }
+  static const char *getName(ProfileSection section);
+  static const char *getLabel(ProfileSection section); // 4 chars, for the OLED
+  static float toMicros(uint32_t cycles) { return cycles / (float)(F_CPU_ACTUAL / 1000000); }
+
+  // Serial: 'p' prints a report, 'r' clears all stats
+  static void serviceSerial();
+  // Also run on 'r', for stats kept outside the profiler
+  static void onReset(void (*callback)()) { _resetCallback = callback; }
+  static void dump();
+
+private:
+  static ProfileStats _stats[PROF_NUM_SECTIONS];
+  static void (*_resetCallback)();
+};
+
+#ifdef PROFILE_MODE
+#define PROFILE_INIT() Profiler::init()
+#define PROFILE_BEGIN(section) uint32_t _profStart_##section = ARM_DWT_CYCCNT
+#define PROFILE_END(section) Profiler::record(section, ARM_DWT_CYCCNT - _profStart_##section)
+// Uses the section's start as the cycle stamp of sampleUs, so read micros()
+// straight after PROFILE_BEGIN
+#define PROFILE_EDGE(section, idealUs, sampleUs) Profiler::recordEdge(idealUs, sampleUs, _profStart_##section)
+#define PROFILE_MICROS(section, us) Profiler::recordMicros(section, us)
+#define PROFILE_SERVICE() Profiler::serviceSerial()
+#define PROFILE_ON_RESET(callback) Profiler::onReset(callback)
+#else
+// If disabled, these macros evaporate into nothingness
+#define PROFILE_INIT()
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+#define PROFILE_EDGE(section, idealUs, sampleUs)
+#define PROFILE_MICROS(section, us)
+#define PROFILE_SERVICE()
+#define PROFILE_ON_RESET(callback)
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Single-Producer / Single-Consumer Ring Buffer
+// One context pushes (e.g. loop()), one context pops (e.g. an ISR).
+// Neither side ever disables interrupts: each index is written by exactly
+// one side, and the release/acquire pair publishes the slot contents.
+// Holds SIZE - 1 items. SIZE must be a power of two.
+template <typename T, uint16_t SIZE>
+class SpscQueue
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "SpscQueue SIZE must be a power of two");
+
+public:
+  SpscQueue() : _head(0), _tail(0) {}
+
+  // Producer side. Returns false (and drops nothing) when full.
+  bool push(const T &item)
+  {
+    uint16_t head = _head.load(std::memory_order_relaxed);
+    uint16_t next = (head + 1) & (SIZE - 1);
+    if (next == _tail.load(std::memory_order_acquire))
+      return false;
+    _items[head] = item;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T &item)
+  {
+    uint16_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+      return false;
+    item = _items[tail];
+    _tail.store((tail + 1) & (SIZE - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Oldest item without removing it, or nullptr if empty.
+  const T *peek() const
+  {
+    uint16_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+      return nullptr;
+    return &_items[tail];
+  }
+
+  // Consumer side. Discards everything currently queued.
+  void clear()
+  {
+    _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  // Either side (a snapshot, may be stale by the time it is used)
+  bool isEmpty() const { return count() == 0; }
+  uint16_t count() const
+  {
+    return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (SIZE - 1);
+  }
+
+private:
+  T _items[SIZE];
+  std::atomic<uint16_t> _head; // Written by the producer only
+  std::atomic<uint16_t> _tail; // Written by the consumer only
+};
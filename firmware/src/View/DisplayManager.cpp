@@ -1,16 +1,34 @@
 #include "DisplayManager.h"
 
-DisplayManager::DisplayManager(SequencerModel &model, UIManager &ui, uint8_t latchPin)
-    : _model(model), _ui(ui), _leds(latchPin), _u8g2(U8G2_R0, U8X8_PIN_NONE)
+DisplayManager::DisplayManager(SequencerModel &model, UIManager &ui, ClockEngine &clock, uint8_t latchPin)
+    : _model(model), _ui(ui), _clock(clock), _leds(latchPin), _u8g2(U8G2_R0, U8X8_PIN_NONE)
 {
   _lastDrawTime = 0;
+  _shadowValid = false;
+  _xferPage = OLED_PAGES;
+  _lastChunkUs = 0;
+  for (int page = 0; page < OLED_PAGES; page++)
+    _dirtyTiles[page] = 0;
+  _bytesSent = 0;
+  _bytesPerSecond = 0;
+  _lastRateTime = 0;
   _hasRunDiagnostic = false;
   _lastDiagnosticResult = false;
+
+  _ledStepCount = 0;
+  _forceRedraw = true;
+  for (int v = 0; v < NUM_VERSIONS; v++)
+    _drawnVersions[v] = 0;
+  _drawnUIVersion = 0;
+  _drawnPlayhead = -1;
+  _drawnTimers = 0;
+  _drawnSync = 0;
 }
 
 void DisplayManager::init()
 {
   _u8g2.begin();
+  _buildGridTiles();
   _u8g2.setFont(u8g2_font_profont10_mr);
   _leds.begin();
   _leds.clear();
@@ -19,44 +37,38 @@ void DisplayManager::init()
 
 void DisplayManager::update()
 {
-  if (millis() - _lastDrawTime < 33)
-    return;
-  _lastDrawTime = millis();
-
-  // --- LEDs ---
-  _leds.clear();
-
-  if (_model.getPlayMode() == MODE_HARDWARE_TEST)
+  // --- LEDs ON STEP BOUNDARIES ---
+  // Not tied to the frame rate: the running light is latched on the first
+  // loop() pass after the step reaches the outputs
+  uint32_t edgeTime;
+  uint32_t stepCount = _clock.getStepCount(edgeTime);
+  if (stepCount != _ledStepCount)
   {
-    _leds.set(_model.getCurrentStep(), true);
+    _ledStepCount = stepCount;
+    _refreshLeds(edgeTime);
   }
-  else if (_model.getPlayMode() == MODE_SONG)
+
+  // BANDWIDTH COUNTER
+  if (millis() - _lastRateTime >= 1000)
   {
-    if (_model.isPlaying())
-    {
-      _leds.set(_model.getCurrentStep(), true);
-    }
-    else
-    {
-      int patID = _model.getPlaylistPattern(_ui.getSelectedSlot());
-      int ledIndex = patID - _ui.getSongModeBankOffset();
-      if (ledIndex >= 0 && ledIndex < 16)
-        _leds.set(ledIndex, true);
-    }
+    _bytesPerSecond = _bytesSent;
+    _bytesSent = 0;
+    _lastRateTime = millis();
   }
-  else
-  {
-    // Pattern Loop Mode (Show Triggers)
-    int activeTrack = _model.activeTrackID;
-    int viewPattern = _model.currentViewPatternID;
-    for (int i = 0; i < NUM_STEPS; i++)
-    {
-      uint16_t mask = _model.getTriggersForStep(viewPattern, i);
-      if ((mask >> activeTrack) & 1)
-        _leds.set(i, true);
-    }
-  }
-  _leds.show();
+
+  // Keep the previous frame moving; a new one is only drawn once it is out
+  _pumpTransfer();
+  if (_isTransferring())
+    return;
+
+  if (millis() - _lastDrawTime < DISPLAY_FRAME_MS)
+    return;
+  if (!_needsRedraw())
+    return;
+  _lastDrawTime = millis();
+  PROFILE_BEGIN(PROF_DISPLAY);
+
+  _refreshLeds();
 
   // --- OLED ---
   _u8g2.clearBuffer();
@@ -69,11 +81,15 @@ void DisplayManager::update()
       _lastDiagnosticResult = _leds.selfTest();
       _hasRunDiagnostic = true;
     }
+#ifdef PROFILE_MODE
+    _drawProfile();
+#else
     _u8g2.setFont(u8g2_font_6x10_tf);
     _u8g2.drawFrame(10, 20, 108, 30);
     _u8g2.setCursor(20, 40);
     _u8g2.print("HW CHECK: ");
     _u8g2.print(_lastDiagnosticResult ? "OK" : "FAIL");
+#endif
   }
   else
   {
@@ -138,8 +154,8 @@ void DisplayManager::update()
       }
       _u8g2.drawStr(x - 6, y, ">");
     }
-    // SWING OVERLAY (Transient: Shows for 1.5 seconds)
-    else if (millis() - _ui.getLastSwingChangeTime() < 1500)
+    // SWING OVERLAY (Transient: Shows for OVERLAY_TIMEOUT_MS)
+    else if (millis() - _ui.getLastSwingChangeTime() < OVERLAY_TIMEOUT_MS)
     {
       // Draw Box
       _u8g2.setDrawColor(0);
@@ -170,19 +186,235 @@ void DisplayManager::update()
       _drawGrid();
     }
   }
-  _u8g2.sendBuffer();
+  _beginTransfer();
+  PROFILE_END(PROF_DISPLAY);
+}
+
+// Builds the LED frame from the current state and latches it.
+// Brightness tells the layers apart: playhead > steps > swung steps > marker.
+void DisplayManager::_refreshLeds(uint32_t edgeTime)
+{
+  _leds.clear();
+
+  if (_model.getPlayMode() == MODE_HARDWARE_TEST)
+  {
+    _leds.set(_model.getCurrentStep(), true);
+  }
+  else if (_model.getPlayMode() == MODE_SONG)
+  {
+    int bankOffset = _ui.getSongModeBankOffset();
+    if (_model.isPlaying())
+    {
+      // Where the heard pattern sits in the bank, under the running light
+      int bankIndex = _clock.getPlayheadPattern() - bankOffset;
+      if (bankIndex >= 0 && bankIndex < 16)
+        _leds.setLevel(bankIndex, LED_LEVEL_MARKER);
+      _leds.setLevel(_clock.getPlayheadStep(), LED_LEVEL_PLAYHEAD);
+    }
+    else
+    {
+      int patID = _model.getPlaylistPattern(_ui.getSelectedSlot());
+      int ledIndex = patID - bankOffset;
+      if (ledIndex >= 0 && ledIndex < 16)
+        _leds.set(ledIndex, true);
+    }
+  }
+  else
+  {
+    // Pattern Loop Mode (Show Triggers)
+    int viewPattern = _model.currentViewPatternID;
+    uint16_t steps = _model.getTrackSteps(viewPattern, _model.activeTrackID);
+    uint16_t swung = 0;
+    if (_model.getTrackSwing(_model.activeTrackID) > 10)
+      swung = steps & 0xAAAA; // Odd steps are the delayed ones
+
+    _leds.setAllLevel(steps & ~swung, LED_LEVEL_STEP);
+    _leds.setAllLevel(swung, LED_LEVEL_SWUNG);
+
+    if (_model.isPlaying() && viewPattern == _clock.getPlayheadPattern())
+      _leds.setLevel(_clock.getPlayheadStep(), LED_LEVEL_PLAYHEAD);
+  }
+  _leds.show(edgeTime);
+}
+
+// -------------------------------------------------------------------------
+// CHANGE DETECTION
+// -------------------------------------------------------------------------
+// Compares what the last frame was drawn from against the current state.
+// Nothing changed means no redraw, no LED shift and no I2C traffic.
+bool DisplayManager::_needsRedraw()
+{
+  // Live diagnostics and the LED walk change every frame
+  if (_model.getPlayMode() == MODE_HARDWARE_TEST)
+    return true;
+
+  bool changed = _forceRedraw;
+  _forceRedraw = false;
+
+  for (int v = 0; v < NUM_VERSIONS; v++)
+  {
+    uint32_t version = _model.getVersion((ModelVersion)v);
+    if (version != _drawnVersions[v])
+    {
+      _drawnVersions[v] = version;
+      changed = true;
+    }
+  }
+
+  if (_ui.getVersion() != _drawnUIVersion)
+  {
+    _drawnUIVersion = _ui.getVersion();
+    changed = true;
+  }
+
+  int playhead = _model.isPlaying() ? _clock.getPlayheadStep() : -1;
+  if (playhead != _drawnPlayhead)
+  {
+    _drawnPlayhead = playhead;
+    changed = true;
+  }
+
+  uint8_t timers = _timedState();
+  if (timers != _drawnTimers)
+  {
+    _drawnTimers = timers;
+    changed = true;
+  }
+
+  uint32_t sync = _syncState();
+  if (sync != _drawnSync)
+  {
+    _drawnSync = sync;
+    changed = true;
+  }
+
+  return changed;
+}
+
+// What the header shows of the external clock. Whole BPM only, so the
+// PLL's pulse-to-pulse flutter doesn't redraw the screen.
+uint32_t DisplayManager::_syncState()
+{
+  SyncStatus status = _clock.getSyncStatus();
+  if (status == SYNC_OFF)
+    return 0;
+  return ((uint32_t)status << 16) | ((_clock.getSyncCentiBPM() + 50) / 100);
+}
+
+// Phase of every blinking or timing-out element, one bit each
+uint8_t DisplayManager::_timedState()
+{
+  unsigned long now = millis();
+  uint8_t state = 0;
+
+  if (_ui.getMode() == UI_MODE_NUMBER_INPUT && (now / CURSOR_BLINK_MS) % 2 == 0)
+    state |= 0x01;
+  if (_model.getPendingPatternID() != _model.getPlayingPatternID() && (now / TRANSITION_BLINK_MS) % 2 == 0)
+    state |= 0x02;
+  if (now - _ui.getLastSwingChangeTime() < OVERLAY_TIMEOUT_MS)
+    state |= 0x04;
+
+  return state;
+}
+
+// Snapshots the finished frame into the shadow and marks the 8x8 tiles
+// that differ from what the panel shows. Most frames only touch the
+// playhead column and maybe the header, so this is usually a handful of
+// tiles rather than the full 1 KB.
+void DisplayManager::_beginTransfer()
+{
+  uint8_t *buffer = _u8g2.getBufferPtr();
+
+  for (int page = 0; page < OLED_PAGES; page++)
+  {
+    uint8_t *src = buffer + page * OLED_PAGE_BYTES;
+    uint8_t *dst = _shadow + page * OLED_PAGE_BYTES;
+    uint16_t dirty = 0;
+
+    for (int tile = 0; tile < OLED_PAGE_TILES; tile++)
+    {
+      if (!_shadowValid || memcmp(src + tile * 8, dst + tile * 8, 8) != 0)
+        dirty |= (1 << tile);
+    }
+
+    if (dirty)
+      memcpy(dst, src, OLED_PAGE_BYTES);
+    _dirtyTiles[page] = dirty;
+  }
+
+  _shadowValid = true;
+  _xferPage = 0;
+  _pumpTransfer();
+}
+
+// Sends runs of dirty tiles until the per-pass budget would be exceeded.
+// At least one chunk goes out per call so the transfer always progresses.
+// Hardware I2C through Wire is blocking, so the chunk size is what bounds
+// the stall.
+void DisplayManager::_pumpTransfer()
+{
+  if (!_isTransferring())
+    return;
+
+  PROFILE_BEGIN(PROF_DISPLAY_XFER);
+  u8x8_t *u8x8 = _u8g2.getU8x8();
+  uint32_t start = micros();
+
+  do
+  {
+    while (_xferPage < OLED_PAGES && _dirtyTiles[_xferPage] == 0)
+      _xferPage++;
+    if (_xferPage >= OLED_PAGES)
+      break;
+
+    // Next run of consecutive dirty tiles, capped at the chunk size
+    uint16_t dirty = _dirtyTiles[_xferPage];
+    int first = __builtin_ctz(dirty);
+    int count = 0;
+    while (count < DISPLAY_CHUNK_TILES && first + count < OLED_PAGE_TILES && ((dirty >> (first + count)) & 1))
+      count++;
+
+    uint32_t chunkStart = micros();
+    u8x8_DrawTile(u8x8, first, _xferPage, count, _shadow + _xferPage * OLED_PAGE_BYTES + first * 8);
+    _lastChunkUs = micros() - chunkStart;
+
+    _dirtyTiles[_xferPage] &= ~(((1 << count) - 1) << first);
+    _bytesSent += count * 8;
+  } while (micros() - start + _lastChunkUs <= DISPLAY_BUDGET_US);
+
+  PROFILE_END(PROF_DISPLAY_XFER);
 }
 
 void DisplayManager::_drawHeader()
 {
   _u8g2.setFont(u8g2_font_6x10_tf);
 
-  if (_ui.getMode() == UI_MODE_BPM_INPUT)
+  if (_ui.getMode() == UI_MODE_NUMBER_INPUT)
   {
     _u8g2.setCursor(0, 8);
-    _u8g2.print("SET BPM: > ");
+    switch (_ui.getInputTarget())
+    {
+    case INPUT_BPM:
+      _u8g2.print("SET BPM: > ");
+      break;
+    case INPUT_GATE_WIDTH:
+      _u8g2.print("GATE ");
+      _u8g2.print((char)('A' + _model.activeTrackID));
+      _u8g2.print(" MS: > ");
+      break;
+    case INPUT_MIDI_NOTE:
+      _u8g2.print("NOTE ");
+      _u8g2.print((char)('A' + _model.activeTrackID));
+      _u8g2.print(": > ");
+      break;
+    case INPUT_MIDI_CHANNEL:
+      _u8g2.print("CHANNEL ");
+      _u8g2.print((char)('A' + _model.activeTrackID));
+      _u8g2.print(": > ");
+      break;
+    }
     _u8g2.print(_ui.getInputBuffer());
-    if ((millis() / 500) % 2 == 0)
+    if ((millis() / CURSOR_BLINK_MS) % 2 == 0)
       _u8g2.print("_");
     return;
   }
@@ -205,7 +437,7 @@ void DisplayManager::_drawHeader()
     // Transitioning! Blink the Target
     _u8g2.print(playing + 1);
     _u8g2.print(">");
-    if ((millis() / 150) % 2 == 0)
+    if ((millis() / TRANSITION_BLINK_MS) % 2 == 0)
     { // Fast Blink
       _u8g2.print(pending + 1);
     }
@@ -226,17 +458,111 @@ void DisplayManager::_drawHeader()
   else
     _u8g2.print("LOOP");
 
-  // BPM
+  // BPM (the followed tempo when slaved, once it is known)
+  SyncStatus sync = _clock.getSyncStatus();
+  int syncBPM = (_clock.getSyncCentiBPM() + 50) / 100;
   _u8g2.setCursor(100, 8);
-  _u8g2.print(_model.getBPM());
+  _u8g2.print((sync != SYNC_OFF && syncBPM > 0) ? syncBPM : _model.getBPM());
+
+  // Sync: hollow while searching, filled when locked
+  if (sync == SYNC_LOCKED)
+    _u8g2.drawDisc(124, 4, 3);
+  else if (sync == SYNC_SEARCHING)
+    _u8g2.drawCircle(124, 4, 3);
+}
+
+// -------------------------------------------------------------------------
+// GRID TILES
+// -------------------------------------------------------------------------
+// Every grid cell and gutter label is one of a few fixed images. They are
+// drawn once with the normal U8g2 calls at init(), read back from the
+// frame buffer as 16-pixel-tall columns, and from then on ORed straight
+// into the page buffer. Rows are 12px apart, so most rows straddle a page
+// boundary: each column is shifted into place across up to three pages.
+void DisplayManager::_buildGridTiles()
+{
+  uint8_t *buffer = _u8g2.getBufferPtr();
+
+  for (int type = 0; type < GRID_CELL_TYPES; type++)
+  {
+    _u8g2.clearBuffer();
+    bool isNoteOn = type & GRID_CELL_ON;
+    bool isSwung = type & GRID_CELL_SWUNG;
+
+    // Swing Visuals (Narrow/Shifted box)
+    int boxX = 1;
+    int boxW = 6;
+    if (isSwung)
+    {
+      boxX += 2;
+      boxW -= 2;
+    }
+
+    if (isNoteOn)
+    {
+      _u8g2.drawBox(boxX, 0, boxW, 8);
+    }
+    else
+    {
+      int dotX = isSwung ? 5 : 3;
+      _u8g2.drawPixel(dotX, 4);
+    }
+
+    for (int c = 0; c < GRID_STEP_W; c++)
+      _cellTiles[type][c] = buffer[c] | (buffer[OLED_PAGE_BYTES + c] << 8);
+  }
+
+  _u8g2.setFont(u8g2_font_profont10_mr);
+  for (int active = 0; active < 2; active++)
+  {
+    for (int t = 0; t < NUM_TRACKS; t++)
+    {
+      _u8g2.clearBuffer();
+      if (active)
+      {
+        // Highlight Active Track
+        _u8g2.setDrawColor(1);
+        _u8g2.drawBox(GRID_LABEL_X, 0, GRID_LABEL_W, 11);
+        _u8g2.setDrawColor(0); // Invert text
+      }
+      _u8g2.setCursor(GRID_LABEL_X + 2, 9);
+      _u8g2.print((char)('A' + t));
+      _u8g2.setDrawColor(1); // Restore
+
+      for (int c = 0; c < GRID_LABEL_W; c++)
+      {
+        int x = GRID_LABEL_X + c;
+        _labelTiles[active][t][c] = buffer[x] | (buffer[OLED_PAGE_BYTES + x] << 8);
+      }
+    }
+  }
+
+  _u8g2.clearBuffer();
+}
+
+// ORs a strip of 16px columns into the frame buffer with its top at y
+void DisplayManager::_blitColumns(int x, int y, const uint16_t *columns, int width)
+{
+  uint8_t *buffer = _u8g2.getBufferPtr();
+  int page = y >> 3;
+  int shift = y & 7;
+
+  for (int c = 0; c < width; c++)
+  {
+    uint32_t bits = (uint32_t)columns[c] << shift;
+    uint8_t *dst = buffer + page * OLED_PAGE_BYTES + x + c;
+    for (int p = page; p < OLED_PAGES && bits; p++)
+    {
+      *dst |= bits & 0xFF;
+      bits >>= 8;
+      dst += OLED_PAGE_BYTES;
+    }
+  }
 }
 
 void DisplayManager::_drawGrid()
 {
-  int stepWidth = 7;
-  int trackHeight = 12;
-  int startY = 16;
-  int visibleRows = 4; // We show 4 tracks at a time
+  int visibleRows = GRID_ROWS; // We show 4 tracks at a time
 
   // 1. Calculate Scroll Offset
   // Automatically scroll to keep the active track visible
@@ -252,7 +578,9 @@ void DisplayManager::_drawGrid()
   }
 
   int viewPattern = _model.currentViewPatternID;
-  int playingPattern = _model.getPlayingPatternID();
+  // The model runs ahead by the lookahead, so it may already be on the
+  // next pattern; the playhead belongs to the one being heard
+  int playingPattern = _clock.getPlayheadPattern();
 
   // 2. Draw Visible Tracks
   for (int i = 0; i < visibleRows; i++)
@@ -261,68 +589,34 @@ void DisplayManager::_drawGrid()
     if (trackIndex >= NUM_TRACKS)
       break;
 
-    uint8_t swing = _model.getTrackSwing(trackIndex);
-
-    // --- DRAW GUTTER LABEL (RIGHT SIDE) ---
-    // Grid ends at 112px. We draw label at 116px.
-    int labelY = startY + (i * trackHeight) + 9;
+    int y = GRID_START_Y + (i * GRID_TRACK_H);
+    uint16_t trackSteps = _model.getTrackSteps(viewPattern, trackIndex);
 
-    _u8g2.setFont(u8g2_font_profont10_mr);
+    // Odd steps are drawn shifted when the track swings noticeably
+    uint16_t swungSteps = (_model.getTrackSwing(trackIndex) > 10) ? 0xAAAA : 0;
 
-    if (trackIndex == _model.activeTrackID)
-    {
-      // Highlight Active Track
-      _u8g2.setDrawColor(1);
-      _u8g2.drawBox(115, startY + (i * trackHeight), 12, 11);
-      _u8g2.setDrawColor(0); // Invert text
-      _u8g2.setCursor(117, labelY);
-      _u8g2.print((char)('A' + trackIndex));
-      _u8g2.setDrawColor(1); // Restore
-    }
-    else
-    {
-      _u8g2.setCursor(117, labelY);
-      _u8g2.print((char)('A' + trackIndex));
-    }
+    // --- GUTTER LABEL (RIGHT SIDE) ---
+    // Grid ends at 112px, the label sits at 115px
+    bool isActive = (trackIndex == _model.activeTrackID);
+    _blitColumns(GRID_LABEL_X, y, _labelTiles[isActive][trackIndex], GRID_LABEL_W);
 
-    // --- DRAW STEPS ---
+    // --- STEPS ---
     for (int step = 0; step < NUM_STEPS; step++)
     {
-      int x = step * stepWidth;
-      int y = startY + (i * trackHeight);
-
-      uint16_t mask = _model.getTriggersForStep(viewPattern, step);
-      bool isNoteOn = (mask >> trackIndex) & 1;
-
-      // Swing Visuals (Narrow/Shifted box)
-      int boxX = x + 1;
-      int boxW = 6;
-      if ((step % 2 != 0) && (swing > 10))
-      {
-        boxX += 2;
-        boxW -= 2;
-      }
-
-      if (isNoteOn)
-      {
-        _u8g2.drawBox(boxX, y, boxW, 8);
-      }
-      else
-      {
-        int dotX = x + 3;
-        if ((step % 2 != 0) && (swing > 10))
-          dotX += 2;
-        _u8g2.drawPixel(dotX, y + 4);
-      }
+      int type = ((trackSteps >> step) & 1) ? GRID_CELL_ON : 0;
+      if ((swungSteps >> step) & 1)
+        type |= GRID_CELL_SWUNG;
+      _blitColumns(step * GRID_STEP_W, y, _cellTiles[type], GRID_STEP_W);
     }
   }
 
   // Playhead (Full Height of View)
   if (_model.isPlaying() && (viewPattern == playingPattern))
   {
-    int cursorX = _model.getCurrentStep() * stepWidth;
+    // The model runs ahead by the lookahead; show what is actually heard
+    int cursorX = _clock.getPlayheadStep() * GRID_STEP_W;
     _u8g2.setDrawColor(2); // XOR mode
-    _u8g2.drawBox(cursorX, startY - 2, stepWidth - 1, (visibleRows * trackHeight) + 4);
+    _u8g2.drawBox(cursorX, GRID_START_Y - 2, GRID_STEP_W - 1, (visibleRows * GRID_TRACK_H) + 4);
     _u8g2.setDrawColor(1);
   }
 }
@@ -361,4 +655,65 @@ void DisplayManager::_drawPlaylist()
   _u8g2.setCursor(0, 60);
   _u8g2.setFont(u8g2_font_profont10_mr);
   _u8g2.print("Shft+<>:Ins | Clr:Del");
-}
\ No newline at end of file
+}
+#ifdef PROFILE_MODE
+// Hardware test screen with timing stats. Two columns of sections, each
+// "LABEL avg max" in us, then the lookahead health underneath.
+void DisplayManager::_drawProfile()
+{
+  _u8g2.setFont(u8g2_font_profont10_mr);
+  _u8g2.setCursor(0, 7);
+  _u8g2.print("HW:");
+  _u8g2.print(_lastDiagnosticResult ? "OK" : "FAIL");
+  _u8g2.print(" OLED ");
+  _u8g2.print(_bytesPerSecond);
+  _u8g2.print("B/s");
+
+  _u8g2.setFont(u8g2_font_4x6_tr);
+  for (int i = 0; i < PROF_NUM_SECTIONS; i++)
+  {
+    ProfileSection section = (ProfileSection)i;
+    const ProfileStats &s = Profiler::get(section);
+    int x = (i % 2) * 64;
+    int y = 15 + (i / 2) * 6;
+
+    _u8g2.setCursor(x, y);
+    _u8g2.print(Profiler::getLabel(section));
+    _u8g2.setCursor(x + 18, y);
+    if (s.count == 0)
+    {
+      _u8g2.print("-");
+      continue;
+    }
+    _printMicros(Profiler::toMicros((uint32_t)(s.totalCycles / s.count)));
+    _u8g2.setCursor(x + 42, y);
+    _printMicros(Profiler::toMicros(s.maxCycles));
+  }
+
+  // LED chain traffic: writes sent vs. skipped as already latched
+  _u8g2.setCursor(0, 58);
+  _u8g2.print("LED TX ");
+  _u8g2.print(_leds.getTransferCount());
+  _u8g2.print(" SKIP ");
+  _u8g2.print(_leds.getSkipCount());
+
+  // Lookahead health: dry spells and the closest call, then UI edits lost
+  // to a full edit queue
+  _u8g2.setCursor(0, 64);
+  _u8g2.print("UNDERRUN ");
+  _u8g2.print(_clock.getUnderrunCount());
+  _u8g2.print(" LEAD ");
+  _u8g2.print(_clock.getMinLeadUs());
+  _u8g2.print(" DROP ");
+  _u8g2.print(_model.getDroppedEditCount());
+}
+
+// Fits 5 characters: one decimal below 100us, whole microseconds above
+void DisplayManager::_printMicros(float us)
+{
+  if (us < 100)
+    _u8g2.print(us, 1);
+  else
+    _u8g2.print((unsigned long)us);
+}
+#endif
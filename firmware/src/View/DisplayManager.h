@@ -4,20 +4,39 @@
 #include <Wire.h>
 #include "Model/SequencerModel.h"
 #include "Controller/UIManager.h"
+#include "Engine/ClockEngine.h"
+#include "Profiler.h"
 #include "StepLeds.h"
 
+// Step grid geometry
+#define GRID_STEP_W 7   // One step cell
+#define GRID_TRACK_H 12 // Row pitch
+#define GRID_START_Y 16
+#define GRID_ROWS 4 // Tracks visible at once
+#define GRID_LABEL_X 115
+#define GRID_LABEL_W 12
+
+// Cell image index: bit 0 = step on, bit 1 = drawn swing-shifted
+#define GRID_CELL_ON 0x01
+#define GRID_CELL_SWUNG 0x02
+#define GRID_CELL_TYPES 4
+
 class DisplayManager
 {
 public:
   // Updated constructor to accept the hardware pin for LEDs
-  DisplayManager(SequencerModel &model, UIManager &ui, uint8_t latchPin);
+  DisplayManager(SequencerModel &model, UIManager &ui, ClockEngine &clock, uint8_t latchPin);
 
   void init();
   void update(); // Handles both OLED and LEDs
 
+  // OLED traffic over the last full second (page payload only)
+  uint32_t getBytesPerSecond() const { return _bytesPerSecond; }
+
 private:
   SequencerModel &_model;
   UIManager &_ui;
+  ClockEngine &_clock;
   StepLeds _leds; // The LED Driver
 
   // The specific driver for your 1.3" SH1106 OLED
@@ -25,12 +44,55 @@ private:
 
   unsigned long _lastDrawTime;
 
+  // Dirty-tile transfer
+  // Copy of the frame the panel is showing (or being sent). Chunks are sent
+  // from here, so drawing the next frame can never tear the current one.
+  uint8_t _shadow[OLED_PAGES * OLED_PAGE_BYTES];
+  bool _shadowValid;
+  uint16_t _dirtyTiles[OLED_PAGES]; // Bit n: tile n of that page still to send
+  uint8_t _xferPage;                // First page that may still be dirty
+  uint32_t _lastChunkUs;            // Cost of the last chunk, for budgeting
+  uint32_t _bytesSent;      // Running count for the current second
+  uint32_t _bytesPerSecond; // Last complete second
+  unsigned long _lastRateTime;
+
   // Diagnostic State
   bool _hasRunDiagnostic;
   bool _lastDiagnosticResult;
 
+  // LEDs follow the clock's step boundaries, not the frame rate
+  uint32_t _ledStepCount;
+  void _refreshLeds(uint32_t edgeTime = 0); // edgeTime: step edge shown, for LED LAG
+
+  // Change detection (state the last frame was drawn from)
+  bool _forceRedraw;
+  uint32_t _drawnVersions[NUM_VERSIONS];
+  uint32_t _drawnUIVersion;
+  int _drawnPlayhead; // -1 when stopped
+  uint8_t _drawnTimers;
+  uint32_t _drawnSync; // Status and followed BPM
+  bool _needsRedraw();
+  uint8_t _timedState();
+  uint32_t _syncState();
+
+  bool _isTransferring() const { return _xferPage < OLED_PAGES; }
+  void _beginTransfer();
+  void _pumpTransfer();
+
+  // Pre-rendered grid images, one 16px column per entry (bit 0 = top)
+  uint16_t _cellTiles[GRID_CELL_TYPES][GRID_STEP_W];
+  uint16_t _labelTiles[2][NUM_TRACKS][GRID_LABEL_W]; // [active][track]
+  void _buildGridTiles();
+  void _blitColumns(int x, int y, const uint16_t *columns, int width);
+
   // Internal Drawing Routines
   void _drawHeader();
   void _drawGrid();
   void _drawPlaylist();
+#ifdef PROFILE_MODE
+  void _drawProfile();
+  void _printMicros(float us);
+#endif
+
+  friend struct DisplayManagerTest; // Host test against the per-cell drawing
 };
\ No newline at end of file
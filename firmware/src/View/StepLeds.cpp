@@ -1,52 +1,265 @@
 #include "StepLeds.h"
+#include "Profiler.h"
 
-// 2MHz is plenty fast, MSB First is standard for 595s
+#ifdef LED_BCM
+StepLeds *StepLeds::_instance = nullptr;
+#endif
+
+// MSB First is standard for 595s
 StepLeds::StepLeds(uint8_t latchPin)
-    : _latchPin(latchPin), _ledState(0), _spiSettings(2000000, MSBFIRST, SPI_MODE0)
+    : _latchPin(latchPin), _spiSettings(LED_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE0)
 {
+  _latchSetReg = nullptr;
+  _latchClearReg = nullptr;
+  _latchBit = 0;
+  _latchedState = 0;
+  _transfers = 0;
+  _skips = 0;
+  _eventTime = 0;
+  _stampPending = false;
+  for (int i = 0; i < NUM_LEDS; i++)
+    _levels[i] = 0;
+
+#ifdef LED_BCM
+  _instance = this;
+  _front = 0;
+  _bcmBit = 0;
+  for (int f = 0; f < 2; f++)
+    for (int b = 0; b < LED_BCM_BITS; b++)
+      _planes[f][b] = 0;
+#else
+  _busy = false;
+  _wantedState = 0;
+  _inFlight = 0;
+#endif
 }
 
 void StepLeds::begin()
 {
   pinMode(_latchPin, OUTPUT);
   digitalWrite(_latchPin, HIGH); // Default idle state
+  _latchSetReg = portSetRegister(_latchPin);
+  _latchClearReg = portClearRegister(_latchPin);
+  _latchBit = digitalPinToBitMask(_latchPin);
   SPI.begin();
+
+  // Start from a known register state so the first skip check is valid
+  transfer(0x0000);
+  _latchedState = 0x0000;
+
+#ifdef LED_BCM
+  _startRefresh();
+#else
+  _spiEvent.setContext(this);
+  _spiEvent.attachImmediate(onTransferDone);
+#endif
 }
 
 void StepLeds::set(uint8_t index, bool state)
 {
-  if (index >= 16)
+  setLevel(index, state ? LED_LEVEL_MAX : 0);
+}
+
+void StepLeds::setLevel(uint8_t index, uint8_t level)
+{
+  if (index >= NUM_LEDS)
     return; // Safety check
+  _levels[index] = (level > LED_LEVEL_MAX) ? LED_LEVEL_MAX : level;
+}
+
+void StepLeds::setAll(uint16_t state)
+{
+  for (int i = 0; i < NUM_LEDS; i++)
+    _levels[i] = ((state >> i) & 1) ? LED_LEVEL_MAX : 0;
+}
+
+void StepLeds::setAllLevel(uint16_t mask, uint8_t level)
+{
+  for (int i = 0; i < NUM_LEDS; i++)
+  {
+    if (((mask >> i) & 1) && _levels[i] < level)
+      setLevel(i, level);
+  }
+}
+
+void StepLeds::clear()
+{
+  for (int i = 0; i < NUM_LEDS; i++)
+    _levels[i] = 0;
+}
 
-  if (state)
+void StepLeds::show(uint32_t eventTime)
+{
+#ifdef LED_BCM
+  // Transpose levels into bit planes, then publish them in one store
+  uint8_t back = _front ^ 1;
+  bool changed = false;
+  for (int b = 0; b < LED_BCM_BITS; b++)
+  {
+    uint16_t plane = 0;
+    for (int i = 0; i < NUM_LEDS; i++)
+    {
+      if ((_levels[i] >> b) & 1)
+        plane |= (1 << i);
+    }
+    _planes[back][b] = plane;
+    if (plane != _planes[_front][b])
+      changed = true;
+  }
+  if (changed)
   {
-    _ledState |= (1 << index);
+    // The next refresh latches a plane of the new frame and stamps it
+    _stampPending = false;
+    _front = back;
+    _setStamp(eventTime);
   }
   else
   {
-    _ledState &= ~(1 << index);
+    // Already on the LEDs
+    _setStamp(eventTime);
+    _takeStamp();
+  }
+#else
+  uint16_t state = 0;
+  for (int i = 0; i < NUM_LEDS; i++)
+  {
+    if (_levels[i])
+      state |= (1 << i);
   }
+
+  // If a transfer is in flight, its completion picks this up
+  _stampPending = false;
+  _wantedState = state;
+  _setStamp(eventTime);
+  if (!_busy)
+    _startTransfer();
+#endif
 }
 
-void StepLeds::setAll(uint16_t state)
+// The stamp is cleared before the frame is published and set after, so a
+// latch in between can't take it for the previous frame
+void StepLeds::_setStamp(uint32_t eventTime)
 {
-  _ledState = state;
+  _eventTime = eventTime;
+  _stampPending = (eventTime != 0);
 }
 
-void StepLeds::clear()
+void StepLeds::_takeStamp()
+{
+  if (!_stampPending)
+    return;
+  _stampPending = false;
+  PROFILE_MICROS(PROF_LED_LATENCY, micros() - _eventTime);
+}
+
+// One 16-bit shift plus a latch pulse. Caller owns the SPI transaction.
+void StepLeds::_latch(uint16_t data)
+{
+  *_latchClearReg = _latchBit;
+  SPI.transfer16(data); // Teensy optimized 16-bit transfer
+  *_latchSetReg = _latchBit;
+}
+
+#ifdef LED_BCM
+// -------------------------------------------------------------------------
+// BCM REFRESH (ISR)
+// -------------------------------------------------------------------------
+// Runs from a GPT interrupt below the clock's priority, so a tick preempts a
+// refresh instead of waiting for it. The work is still kept to a single
+// transfer16 (no loops, no level math) to keep the LED timing steady.
+void StepLeds::onRefresh()
+{
+  if (_instance)
+    _instance->_handleRefresh();
+}
+
+void StepLeds::_handleRefresh()
+{
+  PROFILE_BEGIN(PROF_LED_REFRESH);
+  uint8_t bit = _bcmBit;
+  uint16_t plane = _planes[_front][bit];
+
+  // Neighbouring planes are often identical (LEDs fully on or off), and
+  // re-latching the same word changes nothing
+  if (plane != _latchedState)
+  {
+    SPI.beginTransaction(_spiSettings);
+    _latch(plane);
+    SPI.endTransaction();
+    _latchedState = plane;
+    _transfers++;
+  }
+  else
+  {
+    _skips++;
+  }
+  // First plane out since show() flipped the frame (a skipped one is
+  // already showing)
+  _takeStamp();
+
+  // Hold this plane for its binary weight, then move to the next
+  _timer.begin(onRefresh, (unsigned int)(LED_BCM_BASE_US << bit));
+  _bcmBit = (bit + 1 < LED_BCM_BITS) ? bit + 1 : 0;
+  PROFILE_END(PROF_LED_REFRESH);
+}
+
+void StepLeds::_startRefresh()
 {
-  _ledState = 0;
+  _bcmBit = 0;
+  _timer.priority(LED_BCM_IRQ_PRIORITY);
+  _timer.begin(onRefresh, LED_BCM_BASE_US);
 }
 
-// Fast update - Blind fire
-void StepLeds::show()
+void StepLeds::_stopRefresh()
+{
+  _timer.end();
+}
+#else
+// -------------------------------------------------------------------------
+// ASYNC WRITE
+// -------------------------------------------------------------------------
+// Caller guarantees no transfer is in flight
+void StepLeds::_startTransfer()
 {
+  uint16_t state = _wantedState;
+  if (state == _latchedState)
+  {
+    _skips++;
+    _takeStamp();
+    return;
+  }
+
+  _busy = true;
+  _inFlight = state;
+  _txBuffer[0] = state >> 8; // MSB first, same order as transfer16
+  _txBuffer[1] = state & 0xFF;
+
   SPI.beginTransaction(_spiSettings);
-  digitalWrite(_latchPin, LOW);
-  SPI.transfer16(_ledState); // Teensy optimized 16-bit transfer
-  digitalWrite(_latchPin, HIGH);
+  *_latchClearReg = _latchBit;
+  SPI.transfer(_txBuffer, nullptr, 2, _spiEvent);
+}
+
+// Runs from the SPI DMA interrupt
+void StepLeds::onTransferDone(EventResponderRef event)
+{
+  ((StepLeds *)event.getContext())->_finishTransfer();
+}
+
+void StepLeds::_finishTransfer()
+{
+  *_latchSetReg = _latchBit;
   SPI.endTransaction();
+  _latchedState = _inFlight;
+  _transfers++;
+  _busy = false;
+  if (_latchedState == _wantedState)
+    _takeStamp();
+
+  // A newer frame came in while this one was shifting out
+  if (_wantedState != _latchedState)
+    _startTransfer();
 }
+#endif
 
 // Diagnostic transfer - Returns the data that was shifted OUT
 uint16_t StepLeds::transfer(uint16_t data)
@@ -54,9 +267,9 @@ uint16_t StepLeds::transfer(uint16_t data)
   uint16_t received = 0;
 
   SPI.beginTransaction(_spiSettings);
-  digitalWrite(_latchPin, LOW);
+  *_latchClearReg = _latchBit;
   received = SPI.transfer16(data);
-  digitalWrite(_latchPin, HIGH);
+  *_latchSetReg = _latchBit;
   SPI.endTransaction();
 
   return received;
@@ -65,6 +278,14 @@ uint16_t StepLeds::transfer(uint16_t data)
 // Validates the full loop: MOSI -> SR1 -> SR2 -> MISO
 bool StepLeds::selfTest()
 {
+#ifdef LED_BCM
+  // The refresh ISR would shift its own data into the chain
+  _stopRefresh();
+#else
+  while (_busy)
+    yield();
+#endif
+
   // 1. Clear the path first (flush unknown state)
   transfer(0x0000);
 
@@ -74,9 +295,14 @@ bool StepLeds::selfTest()
 
   // 3. Send a "Dummy Pattern" (0xFFFF) to push the Test Pattern out
   uint16_t result = transfer(0xFFFF);
+  _latchedState = 0xFFFF; // transfer() latches, so this is on the outputs now
 
+#ifdef LED_BCM
+  _startRefresh();
+#else
   // 4. Restore the actual user state so the LEDs don't stay weird
   show();
+#endif
 
   return (result == 0xA5A5);
-}
\ No newline at end of file
+}
@@ -2,6 +2,13 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include "Config.h"
+#include "GptTimer.h"
+
+#define NUM_LEDS 16
+
+static_assert(LED_BCM_BITS >= 1 && LED_BCM_BITS <= 8, "LED levels are stored as uint8_t");
+static_assert(LED_BCM_BASE_US >= 32, "BCM base period sets the LED ISR rate; keep it cheap");
 
 class StepLeds
 {
@@ -12,12 +19,23 @@ public:
   void begin();
 
   // Frame Buffer Manipulation
-  void set(uint8_t index, bool state);
+  void set(uint8_t index, bool state); // Full brightness or off
+  void setLevel(uint8_t index, uint8_t level); // 0 - LED_LEVEL_MAX
   void setAll(uint16_t state);
+  void setAllLevel(uint16_t mask, uint8_t level); // Only raises LEDs in mask
   void clear();
 
   // Core Update Methods
-  void show(); // Fast, write-only (Standard Operation)
+  // BCM: rebuilds the bit planes and hands them to the refresh ISR.
+  // Otherwise: queues a DMA SPI write (any level > 0 is ON) and returns.
+  // Either way, data the registers already hold is never sent again.
+  // eventTime: micros() of what the frame shows (a step edge), or 0. The
+  // time from it to the frame's first latch is profiled as LED LAG.
+  void show(uint32_t eventTime = 0);
+
+  // Profiling: 16-bit writes that went out vs. ones skipped as unchanged
+  uint32_t getTransferCount() const { return _transfers; }
+  uint32_t getSkipCount() const { return _skips; }
 
   // Diagnostics & Validation
   // Writes current buffer, returns what was PREVIOUSLY in the register
@@ -28,6 +46,54 @@ public:
 
 private:
   uint8_t _latchPin;
-  uint16_t _ledState; // The "Frame Buffer"
+  uint8_t _levels[NUM_LEDS]; // The "Frame Buffer"
   SPISettings _spiSettings;
-};
\ No newline at end of file
+
+  // Latch as a direct GPIO write, cheap enough for the refresh ISR
+  volatile uint32_t *_latchSetReg;
+  volatile uint32_t *_latchClearReg;
+  uint32_t _latchBit;
+
+  void _latch(uint16_t data);
+
+  // What the 595 outputs currently show (written by whoever latches)
+  volatile uint16_t _latchedState;
+  volatile uint32_t _transfers;
+  volatile uint32_t _skips;
+
+  // Latency stamp: set by show(), taken by whoever latches the frame
+  volatile uint32_t _eventTime;
+  volatile bool _stampPending;
+  void _setStamp(uint32_t eventTime);
+  void _takeStamp();
+
+#ifdef LED_BCM
+  // BIT PLANES (double buffered)
+  // _planes[f][b] has bit n set when LED n's level has bit b set. show()
+  // fills the back buffer and flips _front, so the ISR never sees half of
+  // a frame.
+  static StepLeds *_instance;
+  GptTimer _timer; // Own interrupt, below the clock's PIT
+  uint16_t _planes[2][LED_BCM_BITS];
+  volatile uint8_t _front;
+  volatile uint8_t _bcmBit; // Plane going out next (ISR)
+
+  static void onRefresh();
+  void _handleRefresh();
+  void _startRefresh();
+  void _stopRefresh();
+#else
+  // ASYNC WRITE
+  // show() starts a DMA transfer and the completion callback raises the
+  // latch. A frame that arrives mid-transfer is sent from the callback.
+  EventResponder _spiEvent;
+  uint8_t _txBuffer[2];
+  volatile bool _busy;
+  volatile uint16_t _wantedState;
+  uint16_t _inFlight;
+
+  static void onTransferDone(EventResponderRef event);
+  void _startTransfer();
+  void _finishTransfer();
+#endif
+};
@@ -1,4 +1,5 @@
 #include "Debug.h"
+#include "Profiler.h"
 #include <Arduino.h>
 #include <USBHost_t36.h>
 
@@ -14,6 +15,7 @@ USBHost myusb;
 USBHub hub1(myusb);
 USBHub hub2(myusb); // Support for daisy-chained hubs
 KeyboardController keyboard1(myusb);
+MIDIDevice midi1(myusb); // Clock source in slave mode
 
 // --- COMPONENT INSTANTIATION ---
 // Hardware Definitions
@@ -25,10 +27,7 @@ ClockEngine clockEngine(model, driver);
 UIManager ui(model, driver, clockEngine);
 
 // DisplayManager now receives the Latch Pin for the LEDs
-DisplayManager display(model, ui, PIN_SR_LATCH);
-
-// --- FORWARD DECLARATION ---
-void globalKeyPress(int key);
+DisplayManager display(model, ui, clockEngine, PIN_SR_LATCH);
 
 // --- SETUP ---
 void setup()
@@ -37,29 +36,34 @@ void setup()
   // Serial.begin(9600);
 
   // 1. Init Subsystems
+  PROFILE_INIT();
   driver.init();
   display.init(); // Inits OLED and LEDs
   ui.init();
 
   // 2. Init USB
   myusb.begin();
-  keyboard1.attachPress(globalKeyPress);
+  keyboard1.attachRawPress(UsbKeyboard::onRawPress);
+  keyboard1.attachRawRelease(UsbKeyboard::onRawRelease);
+  midi1.setHandleClock(ClockSync::onMidiClock);
+  midi1.setHandleStart(ClockSync::onMidiStart);
+  midi1.setHandleContinue(ClockSync::onMidiStart);
+  midi1.setHandleStop(ClockSync::onMidiStop);
 
   clockEngine.init();
-}
-
-// --- GLOBAL BRIDGE ---
-// USBHost library requires a void function(int), not a class method.
-void globalKeyPress(int key)
-{
-  ui.handleKeyPress(key);
+  PROFILE_ON_RESET([] { clockEngine.resetLookaheadStats(); });
 }
 
 // --- MAIN LOOP ---
 void loop()
 {
   // 1. HARDWARE TASKS
+  PROFILE_BEGIN(PROF_USB_TASK);
   myusb.Task();
+  // The clock handlers run (and timestamp each message) inside read()
+  while (midi1.read())
+    ;
+  PROFILE_END(PROF_USB_TASK);
 
   // 2. TIMING ENGINE
   clockEngine.update();
@@ -67,4 +71,7 @@ void loop()
   // 3. INTERFACE
   ui.processInput();
   display.update();
+
+  // 4. DIAGNOSTICS
+  PROFILE_SERVICE();
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+// Host stand-in for the ADC library: conversions never complete.
+#include <Arduino.h>
+
+namespace ADC_CONVERSION_SPEED
+{
+enum ADC_CONVERSION_SPEED
+{
+  VERY_LOW_SPEED
+};
+}
+namespace ADC_SAMPLING_SPEED
+{
+enum ADC_SAMPLING_SPEED
+{
+  VERY_LOW_SPEED
+};
+}
+
+class ADC_Module
+{
+public:
+  void setResolution(uint8_t) {}
+  void setAveraging(uint8_t) {}
+  void setConversionSpeed(ADC_CONVERSION_SPEED::ADC_CONVERSION_SPEED) {}
+  void setSamplingSpeed(ADC_SAMPLING_SPEED::ADC_SAMPLING_SPEED) {}
+  void enableInterrupts(void (*)(), uint8_t = 255) {}
+  bool startContinuous(uint8_t) { return true; }
+  int analogReadContinuous() { return 0; }
+};
+
+class ADC
+{
+public:
+  ADC_Module *adc0 = &_modules[0];
+  ADC_Module *adc1 = &_modules[1];
+
+private:
+  ADC_Module _modules[2];
+};
@@ -0,0 +1,365 @@
+#pragma once
+// Host stand-in for the Teensy core, just enough to build src/ for the
+// native test environment. Time only moves when a test calls
+// host::advanceTo(), which also fires any IntervalTimer that falls due.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define MSBFIRST 1
+
+#define F_CPU 600000000
+#define F_CPU_ACTUAL 600000000
+
+// ----------------------------------------------------------------------
+// HOST STATE
+// ----------------------------------------------------------------------
+class IntervalTimer;
+
+namespace host
+{
+inline uint32_t nowUs = 0;
+
+#define HOST_NUM_PINS 55
+#define HOST_MAX_TIMERS 8
+
+// GPIO register files for the ports the trigger pins live on (GPIO6-9)
+// plus one for every other pin. Same layout as the i.MX RT1062: DR at
+// word 0, DR_SET at 33, DR_CLEAR at 34, DR_TOGGLE at 35.
+enum
+{
+  GPIO6,
+  GPIO7,
+  GPIO8,
+  GPIO9,
+  GPIO_OTHER,
+  NUM_GPIO
+};
+inline volatile uint32_t gpio[NUM_GPIO][36];
+inline uint8_t pinLevel[HOST_NUM_PINS];
+inline void (*pinIsr[HOST_NUM_PINS])();
+
+inline IntervalTimer *timers[HOST_MAX_TIMERS];
+inline uint32_t timerSeq = 0;
+
+void advanceTo(uint32_t t);
+void reset();
+} // namespace host
+
+// ----------------------------------------------------------------------
+// TIME, CPU
+// ----------------------------------------------------------------------
+inline uint32_t micros() { return host::nowUs; }
+inline uint32_t millis() { return host::nowUs / 1000; }
+inline void delay(uint32_t ms) { host::advanceTo(host::nowUs + ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { host::advanceTo(host::nowUs + us); }
+inline void yield() {}
+
+namespace host
+{
+inline bool irqsOff = false; // Between noInterrupts() and interrupts()
+inline bool inIsr = false;   // Inside a timer callback or vector
+void runPending();
+} // namespace host
+
+inline void noInterrupts() { host::irqsOff = true; }
+inline void interrupts()
+{
+  host::irqsOff = false;
+  host::runPending();
+}
+
+inline volatile uint32_t ARM_DWT_CYCCNT;
+inline volatile uint32_t ARM_DEMCR;
+inline volatile uint32_t ARM_DWT_CTRL;
+#define ARM_DEMCR_TRCENA (1 << 24)
+#define ARM_DWT_CTRL_CYCCNTENA (1 << 0)
+
+// ----------------------------------------------------------------------
+// PINS
+// ----------------------------------------------------------------------
+struct digital_pin_bitband_and_config_table_struct
+{
+  volatile uint32_t *reg;
+  uint32_t mask;
+};
+
+// Trigger outputs 25-32 on their real ports and bits; the rest share a
+// spare register file on bit 0, which no test looks at.
+inline digital_pin_bitband_and_config_table_struct digital_pin_to_info_PGM[HOST_NUM_PINS] = {};
+
+inline bool hostInitPins()
+{
+  static const uint8_t port[8] = {host::GPIO6, host::GPIO6, host::GPIO6, host::GPIO8,
+                                  host::GPIO9, host::GPIO8, host::GPIO8, host::GPIO7};
+  static const uint8_t bit[8] = {13, 30, 31, 18, 31, 23, 22, 12};
+  for (int pin = 0; pin < HOST_NUM_PINS; pin++)
+  {
+    digital_pin_to_info_PGM[pin].reg = host::gpio[host::GPIO_OTHER];
+    digital_pin_to_info_PGM[pin].mask = 1;
+    host::pinLevel[pin] = HIGH;
+  }
+  for (int i = 0; i < 8; i++)
+  {
+    digital_pin_to_info_PGM[25 + i].reg = host::gpio[port[i]];
+    digital_pin_to_info_PGM[25 + i].mask = 1u << bit[i];
+  }
+  return true;
+}
+inline bool hostPinsReady = hostInitPins();
+
+#define portOutputRegister(pin) ((digital_pin_to_info_PGM[(pin)].reg + 0))
+#define portSetRegister(pin) ((digital_pin_to_info_PGM[(pin)].reg + 33))
+#define portClearRegister(pin) ((digital_pin_to_info_PGM[(pin)].reg + 34))
+#define portToggleRegister(pin) ((digital_pin_to_info_PGM[(pin)].reg + 35))
+#define digitalPinToBitMask(pin) (digital_pin_to_info_PGM[(pin)].mask)
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) { host::pinLevel[pin] = val; }
+inline void digitalWriteFast(uint8_t pin, uint8_t val) { host::pinLevel[pin] = val; }
+inline int digitalRead(uint8_t pin) { return host::pinLevel[pin]; }
+inline int analogRead(uint8_t) { return 0; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t pin, void (*fn)(), int) { host::pinIsr[pin] = fn; }
+inline void detachInterrupt(uint8_t pin) { host::pinIsr[pin] = nullptr; }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+template <class T, class L, class H>
+inline T constrain(T x, L lo, H hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+// ----------------------------------------------------------------------
+// INTERVAL TIMER
+// ----------------------------------------------------------------------
+// One-shot or periodic callback on host time. Calling begin() from the
+// callback re-arms it from the moment it fired, like the PIT.
+class IntervalTimer
+{
+public:
+  ~IntervalTimer() { end(); }
+
+  bool begin(void (*fn)(), unsigned int us)
+  {
+    _fn = fn;
+    _period = us;
+    _due = host::nowUs + us;
+    _seq = ++host::timerSeq;
+    for (IntervalTimer *&slot : host::timers)
+      if (slot == this)
+        return true;
+    for (IntervalTimer *&slot : host::timers)
+      if (!slot)
+      {
+        slot = this;
+        return true;
+      }
+    return false;
+  }
+  bool begin(void (*fn)(), int us) { return begin(fn, (unsigned int)us); }
+  bool begin(void (*fn)(), unsigned long us) { return begin(fn, (unsigned int)us); }
+  void update(unsigned int us) { _period = us; }
+  void priority(uint8_t) {}
+  void end()
+  {
+    for (IntervalTimer *&slot : host::timers)
+      if (slot == this)
+        slot = nullptr;
+  }
+
+  void (*_fn)() = nullptr;
+  uint32_t _period = 0;
+  uint32_t _due = 0;
+  uint32_t _seq = 0;
+};
+
+namespace host
+{
+// Fires every timer due up to t in time order, with micros() reading the
+// moment each one fires
+inline void advanceTo(uint32_t t)
+{
+  for (;;)
+  {
+    IntervalTimer *next = nullptr;
+    for (IntervalTimer *timer : timers)
+      if (timer && (int32_t)(timer->_due - t) <= 0 &&
+          (!next || (int32_t)(timer->_due - next->_due) < 0))
+        next = timer;
+    if (!next)
+      break;
+
+    nowUs = next->_due;
+    uint32_t seq = next->_seq;
+    inIsr = true;
+    next->_fn();
+    inIsr = false;
+    if (next->_seq == seq)
+      next->_due += next->_period;
+    runPending(); // Tail-chained, at the same instant
+  }
+  nowUs = t;
+}
+
+void resetIrqs();
+
+inline void reset()
+{
+  for (IntervalTimer *&slot : timers)
+    slot = nullptr;
+  resetIrqs();
+  memset((void *)gpio, 0, sizeof(gpio));
+  nowUs = 0;
+}
+} // namespace host
+
+// ----------------------------------------------------------------------
+// GPT, CCM, NVIC
+// ----------------------------------------------------------------------
+// Plain registers: GptTimer configures them, but GPT interrupts never fire
+// on the host. A pended vector (the software interrupt) runs as soon as
+// nothing masks it: right away from loop(), or once the timer callback
+// that pended it returns. Priorities are not modelled.
+enum IRQ_NUMBER_t
+{
+  IRQ_SOFTWARE = 70,
+  IRQ_GPT1 = 100,
+  IRQ_GPT2 = 101,
+  IRQ_PIT = 122,
+  HOST_NUM_IRQS = 160
+};
+
+namespace host
+{
+inline void (*vectors[HOST_NUM_IRQS])();
+inline uint8_t irqPriority[HOST_NUM_IRQS];
+inline bool irqEnabled[HOST_NUM_IRQS];
+inline bool irqPending[HOST_NUM_IRQS];
+
+inline void runPending()
+{
+  if (irqsOff || inIsr)
+    return;
+  for (int irq = 0; irq < HOST_NUM_IRQS; irq++)
+    if (irqPending[irq] && irqEnabled[irq] && vectors[irq])
+    {
+      irqPending[irq] = false;
+      inIsr = true;
+      vectors[irq]();
+      inIsr = false;
+    }
+}
+
+inline void setPending(int irq)
+{
+  irqPending[irq] = true;
+  runPending();
+}
+
+inline void enableIrq(int irq)
+{
+  irqEnabled[irq] = true;
+  runPending();
+}
+} // namespace host
+
+inline void attachInterruptVector(IRQ_NUMBER_t irq, void (*fn)()) { host::vectors[irq] = fn; }
+#define NVIC_SET_PRIORITY(irq, priority) (host::irqPriority[(irq)] = (priority))
+#define NVIC_ENABLE_IRQ(irq) host::enableIrq(irq)
+#define NVIC_DISABLE_IRQ(irq) (host::irqEnabled[(irq)] = false)
+#define NVIC_SET_PENDING(irq) host::setPending(irq)
+
+inline void host::resetIrqs()
+{
+  memset(irqPending, 0, sizeof(irqPending));
+  irqsOff = false;
+  inIsr = false;
+}
+
+inline volatile uint32_t CCM_CCGR0, CCM_CCGR1;
+#define CCM_CCGR_ON 3
+#define CCM_CCGR0_GPT2_BUS(n) ((uint32_t)(((n) & 0x03) << 24))
+#define CCM_CCGR0_GPT2_SERIAL(n) ((uint32_t)(((n) & 0x03) << 26))
+#define CCM_CCGR1_GPT1_BUS(n) ((uint32_t)(((n) & 0x03) << 20))
+#define CCM_CCGR1_GPT1_SERIAL(n) ((uint32_t)(((n) & 0x03) << 22))
+
+inline volatile uint32_t GPT1_CR, GPT1_PR, GPT1_SR, GPT1_IR, GPT1_OCR1;
+inline volatile uint32_t GPT2_CR, GPT2_PR, GPT2_SR, GPT2_IR, GPT2_OCR1;
+#define GPT_CR_EN ((uint32_t)(1 << 0))
+#define GPT_CR_ENMOD ((uint32_t)(1 << 1))
+#define GPT_CR_CLKSRC(n) ((uint32_t)(((n) & 0x07) << 6))
+#define GPT_CR_FRR ((uint32_t)(1 << 9))
+#define GPT_SR_OF1 ((uint32_t)(1 << 0))
+#define GPT_IR_OF1IE ((uint32_t)(1 << 0))
+
+// ----------------------------------------------------------------------
+// SERIAL, USB MIDI
+// ----------------------------------------------------------------------
+class usb_serial_class
+{
+public:
+  void begin(long) {}
+  operator bool() { return true; }
+  int available() { return 0; }
+  int read() { return -1; }
+  template <class... A>
+  int printf(const char *, A...) { return 0; }
+  template <class T>
+  size_t print(T) { return 0; }
+  template <class T>
+  size_t print(T, int) { return 0; }
+  template <class T>
+  size_t println(T) { return 0; }
+  template <class T>
+  size_t println(T, int) { return 0; }
+  size_t println() { return 0; }
+};
+inline usb_serial_class Serial;
+
+#define HOST_MIDI_LOG 1024
+
+// Keeps the last HOST_MIDI_LOG messages, with the moment each was handed over
+class usb_midi_class
+{
+public:
+  struct Sent
+  {
+    uint32_t time;
+    uint8_t status; // Channel voice with channel - 1 in the low nibble
+    uint8_t data1;
+    uint8_t data2;
+  };
+
+  void sendRealTime(uint8_t status, uint8_t = 0) { _log(status, 0, 0); }
+  void sendSongPosition(uint16_t beats, uint8_t = 0) { _log(0xF2, beats & 0x7F, beats >> 7); }
+  void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel, uint8_t = 0) { _log(0x90 | (channel - 1), note, velocity); }
+  void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel, uint8_t = 0) { _log(0x80 | (channel - 1), note, velocity); }
+  void send_now() {}
+
+  const Sent &sent(uint32_t i) const { return log[i % HOST_MIDI_LOG]; }
+
+  uint32_t messages = 0;
+  Sent log[HOST_MIDI_LOG];
+
+private:
+  void _log(uint8_t status, uint8_t data1, uint8_t data2)
+  {
+    log[messages++ % HOST_MIDI_LOG] = {host::nowUs, status, data1, data2};
+  }
+};
+inline usb_midi_class usbMIDI;
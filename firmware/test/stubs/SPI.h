@@ -0,0 +1,55 @@
+#pragma once
+// Host stand-in for the Teensy SPI library. Asynchronous transfers
+// complete immediately.
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+
+class SPISettings
+{
+public:
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class EventResponder;
+typedef EventResponder &EventResponderRef;
+
+class EventResponder
+{
+public:
+  void setContext(void *context) { _context = context; }
+  void *getContext() { return _context; }
+  void attachImmediate(void (*fn)(EventResponderRef)) { _fn = fn; }
+  void triggerEvent()
+  {
+    if (_fn)
+      _fn(*this);
+  }
+
+private:
+  void *_context = nullptr;
+  void (*_fn)(EventResponderRef) = nullptr;
+};
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint16_t transfer16(uint16_t data)
+  {
+    transfers++;
+    return data;
+  }
+  bool transfer(const void *, void *, size_t, EventResponderRef event)
+  {
+    transfers++;
+    event.triggerEvent();
+    return true;
+  }
+
+  uint32_t transfers = 0;
+};
+inline SPIClass SPI;
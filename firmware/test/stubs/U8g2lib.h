@@ -0,0 +1,148 @@
+#pragma once
+// Host stand-in for U8g2: a real 128x64 page-ordered frame buffer with
+// boxes and pixels drawn exactly, and text drawn as a fixed bit pattern
+// per character so that it still shows up in buffer comparisons. Drawing
+// and state calls are counted in `calls`: on target, each one costs far
+// more than it does here.
+#include <Arduino.h>
+
+typedef struct
+{
+  uint32_t tilesSent;
+} u8x8_t;
+
+inline void u8x8_DrawTile(u8x8_t *u8x8, uint8_t, uint8_t, uint8_t cnt, uint8_t *)
+{
+  u8x8->tilesSent += cnt;
+}
+
+inline const uint8_t u8g2_font_profont10_mr[1] = {5};
+inline const uint8_t u8g2_font_6x10_tf[1] = {6};
+inline const uint8_t u8g2_font_4x6_tr[1] = {4};
+
+#define U8G2_R0 0
+#define U8X8_PIN_NONE 255
+
+class U8G2_SH1106_128X64_NONAME_F_HW_I2C
+{
+public:
+  U8G2_SH1106_128X64_NONAME_F_HW_I2C(int, int) {}
+
+  bool begin() { return true; }
+  void clearBuffer() { memset(_buffer, 0, sizeof(_buffer)); }
+  void sendBuffer() { _u8x8.tilesSent += 128; }
+  void updateDisplayArea(uint8_t, uint8_t, uint8_t w, uint8_t h) { _u8x8.tilesSent += w * h; }
+  uint8_t *getBufferPtr() { return _buffer; }
+  u8x8_t *getU8x8() { return &_u8x8; }
+
+  uint32_t calls = 0;
+
+  void setFont(const uint8_t *font)
+  {
+    calls++;
+    _advance = font[0];
+  }
+  void setDrawColor(uint8_t color)
+  {
+    calls++;
+    _color = color;
+  }
+  void setCursor(int x, int y)
+  {
+    calls++;
+    _x = x;
+    _y = y;
+  }
+
+  void drawPixel(int x, int y)
+  {
+    calls++;
+    _pixel(x, y);
+  }
+  void drawBox(int x, int y, int w, int h)
+  {
+    calls++;
+    for (int j = 0; j < h; j++)
+      for (int i = 0; i < w; i++)
+        _pixel(x + i, y + j);
+  }
+  void drawFrame(int x, int y, int w, int h)
+  {
+    for (int i = 0; i < w; i++)
+    {
+      _pixel(x + i, y);
+      _pixel(x + i, y + h - 1);
+    }
+    for (int j = 1; j < h - 1; j++)
+    {
+      _pixel(x, y + j);
+      _pixel(x + w - 1, y + j);
+    }
+  }
+  void drawDisc(int x, int y, int r) { drawBox(x - r, y - r, 2 * r + 1, 2 * r + 1); }
+  void drawCircle(int x, int y, int r) { drawFrame(x - r, y - r, 2 * r + 1, 2 * r + 1); }
+  void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2)
+  {
+    _pixel(x0, y0);
+    _pixel(x1, y1);
+    _pixel(x2, y2);
+  }
+  void drawStr(int x, int y, const char *s)
+  {
+    setCursor(x, y);
+    print(s);
+  }
+
+  // Print
+  size_t print(char c)
+  {
+    calls++;
+    for (int i = 0; i < 8; i++)
+      if (c & (1 << i))
+        _pixel(_x + (i & 3), _y - 1 - (i >> 2));
+    _x += _advance;
+    return 1;
+  }
+  size_t print(const char *s)
+  {
+    size_t n = 0;
+    while (*s)
+      n += print(*s++);
+    return n;
+  }
+  size_t print(long v) { return _printf("%ld", v); }
+  size_t print(unsigned long v) { return _printf("%lu", v); }
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned int v) { return print((unsigned long)v); }
+  size_t print(double v, int digits = 2) { return _printf("%.*f", digits, v); }
+
+private:
+  uint8_t _buffer[1024];
+  u8x8_t _u8x8 = {0};
+  uint8_t _color = 1;
+  uint8_t _advance = 5;
+  int _x = 0;
+  int _y = 0;
+
+  void _pixel(int x, int y)
+  {
+    if (x < 0 || x > 127 || y < 0 || y > 63)
+      return;
+    uint8_t &b = _buffer[(y >> 3) * 128 + x];
+    uint8_t m = 1 << (y & 7);
+    if (_color == 1)
+      b |= m;
+    else if (_color == 0)
+      b &= ~m;
+    else
+      b ^= m;
+  }
+
+  template <class... A>
+  size_t _printf(const char *format, A... args)
+  {
+    char text[24];
+    snprintf(text, sizeof(text), format, args...);
+    return print(text);
+  }
+};
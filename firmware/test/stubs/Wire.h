@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in for the Wire library (the display stub never uses it)
+#include <Arduino.h>
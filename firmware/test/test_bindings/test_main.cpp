@@ -0,0 +1,659 @@
+// The binding and command tables against the switch and if/else ladders
+// they replaced: every input must map to the same command, and every
+// command must leave the same state in every UI context.
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include <new>
+#include "Controller/UIManager.h"
+
+#define BENCH_EVENTS 1000000
+#define BENCH_RUNS 21
+
+static SequencerModel model; // Too large for the stack
+static OutputDriver driver;
+static ClockEngine clockEngine(model, driver);
+static UIManager ui(model, driver, clockEngine);
+
+// The UIManager internals the reference ladders read and write (a friend)
+struct UIManagerTest
+{
+  UIManager &ui;
+
+  uint32_t &version() { return ui._version; }
+  InterfaceMode &mode() { return ui._currentMode; }
+  int &inputPtr() { return ui._inputPtr; }
+  NumberInputTarget &inputTarget() { return ui._inputTarget; }
+  auto &inputBuffer() { return ui._inputBuffer; } // The array, so sizeof works
+  int &slot() { return ui._uiSelectedSlot; }
+  int &bank() { return ui._songModeBankOffset; }
+
+  InputCommand mapMatrix(const KeyEvent &event) { return ui._mapMatrixToCommand(event); }
+  InputCommand mapKey(const KeyEvent &event) { return ui._mapKeyToCommand(event); }
+  void trigger(int stepIndex) { ui._handleTrigger(stepIndex); }
+};
+static UIManagerTest uiTest{ui};
+
+static void rebuild()
+{
+  host::reset();
+  ui.~UIManager();
+  clockEngine.~ClockEngine();
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+  new (&clockEngine) ClockEngine(model, driver);
+  new (&ui) UIManager(model, driver, clockEngine);
+}
+
+void setUp() { rebuild(); }
+void tearDown() {}
+
+// ----------------------------------------------------------------------
+// REFERENCE: THE LADDERS BEFORE THE TABLES
+// ----------------------------------------------------------------------
+// Transcribed from UIManager before the tables; runs of identical cases
+// (TRIGGER_1..16, TRACK_1..8, PLAYLIST_BANK_1..4) are folded into ranges.
+__attribute__((noinline)) static InputCommand legacyMatrixCommand(int id, bool shift, bool song)
+{
+  if (id >= 1 && id <= 16)
+  {
+    if (shift && id <= 4)
+      return (InputCommand)(CMD_PLAYLIST_BANK_1 + (id - 1));
+    return (InputCommand)(CMD_TRIGGER_1 + (id - 1));
+  }
+
+  switch (id)
+  {
+  case 17:
+  case 18:
+  case 19:
+  case 20:
+  case 21:
+  case 22:
+    return (InputCommand)(CMD_TRACK_1 + (id - 17));
+  case 23:
+    return shift ? CMD_REDO : CMD_TRACK_7;
+  case 24:
+    return shift ? CMD_UNDO : CMD_TRACK_8;
+  case 25:
+    return song ? CMD_PLAYLIST_DELETE : CMD_CLEAR_PROMPT;
+  case 26:
+    return CMD_TRACK_PREV;
+  case 27:
+    return CMD_TRACK_NEXT;
+  case 28:
+    if (shift && song)
+      return CMD_PLAYLIST_INSERT_PREV;
+    return song ? CMD_PLAYLIST_PREV : CMD_PATTERN_PREV;
+  case 29:
+    if (shift && song)
+      return CMD_PLAYLIST_INSERT_NEXT;
+    return song ? CMD_PLAYLIST_NEXT : CMD_PATTERN_NEXT;
+  case 30:
+    return shift ? CMD_QUANTIZE_MENU : CMD_TRANSPORT_TOGGLE;
+  case 31:
+    return shift ? CMD_MODE_TOGGLE : CMD_SONG_MODE_TOGGLE;
+  default:
+    return CMD_NONE;
+  }
+}
+
+// The keyboard was read as ASCII then
+static InputCommand legacyKeyCommand(int key)
+{
+  if (key == ' ')
+    return CMD_TRANSPORT_TOGGLE;
+  if (key == '\t')
+    return CMD_MODE_TOGGLE;
+  if (key == '\r' || key == '\n')
+    return CMD_SONG_MODE_TOGGLE;
+  if (key == 'z')
+    return CMD_UNDO;
+  if (key == 'y')
+    return CMD_REDO;
+  if (key == 'q')
+    return CMD_QUANTIZE_MENU;
+  if (key >= 'a' && key <= 'h')
+    return (InputCommand)(CMD_TRACK_1 + (key - 'a'));
+  if (key == '[')
+    return CMD_PATTERN_PREV;
+  if (key == ']')
+    return CMD_PATTERN_NEXT;
+  if (key >= '1' && key <= '4')
+    return (InputCommand)(CMD_TRIGGER_1 + (key - '1'));
+  return CMD_NONE;
+}
+
+__attribute__((noinline)) static void legacyHandleCommand(InputCommand cmd)
+{
+  uiTest.version()++;
+
+  // --- PRIORITY 1: HARDWARE TEST ---
+  if (cmd == CMD_TEST_TOGGLE)
+  {
+    if (model.getPlayMode() == MODE_HARDWARE_TEST)
+    {
+      model.setPlayMode(MODE_PATTERN_LOOP);
+      model.stop();
+    }
+    else
+    {
+      model.setPlayMode(MODE_HARDWARE_TEST);
+    }
+    return;
+  }
+
+  // --- PRIORITY 2: MODAL HANDLING (MENUS) ---
+  if (uiTest.mode() == UI_MODE_QUANTIZE_MENU)
+  {
+    static const QuantizationMode modes[4] = {Q_BAR, Q_QUARTER, Q_EIGHTH, Q_INSTANT};
+    if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_4)
+      model.setQuantization(modes[cmd - CMD_TRIGGER_1]);
+    uiTest.mode() = UI_MODE_PERFORM;
+    return;
+  }
+
+  if (uiTest.mode() == UI_MODE_CONFIRM_CLEAR_TRACK ||
+      uiTest.mode() == UI_MODE_CONFIRM_CLEAR_PATTERN)
+  {
+    bool isYes = (cmd == CMD_CONFIRM_YES || cmd == CMD_SONG_MODE_TOGGLE);
+    if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_4)
+      isYes = true;
+
+    bool isNo = (cmd == CMD_CONFIRM_NO);
+    if (cmd >= CMD_TRIGGER_13 && cmd <= CMD_TRIGGER_16)
+      isNo = true;
+
+    if (isYes)
+    {
+      if (uiTest.mode() == UI_MODE_CONFIRM_CLEAR_TRACK)
+        model.clearTrack(model.activeTrackID);
+      else
+        model.clearCurrentPattern();
+      uiTest.mode() = UI_MODE_STEP_EDIT;
+    }
+    else if (isNo || cmd == CMD_CLEAR_PROMPT)
+    {
+      if (cmd == CMD_CLEAR_PROMPT)
+        uiTest.mode() = (uiTest.mode() == UI_MODE_CONFIRM_CLEAR_TRACK) ? UI_MODE_CONFIRM_CLEAR_PATTERN
+                                                                          : UI_MODE_CONFIRM_CLEAR_TRACK;
+      else
+        uiTest.mode() = UI_MODE_STEP_EDIT;
+    }
+    return;
+  }
+
+  // Typed BPM entry, routed through the tables after they were written (it
+  // used to fall through to the keys below)
+  if (uiTest.mode() == UI_MODE_NUMBER_INPUT)
+  {
+    int &ptr = uiTest.inputPtr();
+    if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_10)
+    {
+      if (ptr < 3)
+        uiTest.inputBuffer()[ptr++] = (char)('0' + (cmd - CMD_TRIGGER_1 + 1) % 10);
+    }
+    else if (cmd == CMD_INPUT_DELETE)
+    {
+      if (ptr > 0)
+        uiTest.inputBuffer()[--ptr] = 0;
+    }
+    else if (cmd == CMD_CONFIRM_YES || cmd == CMD_SONG_MODE_TOGGLE)
+    {
+      int value = atoi(uiTest.inputBuffer());
+      if (ptr > 0 && uiTest.inputTarget() == INPUT_GATE_WIDTH)
+        model.setTrackGateWidth(model.activeTrackID, min(value, MAX_PULSE_WIDTH_MS));
+      else if (ptr > 0 && uiTest.inputTarget() == INPUT_MIDI_NOTE)
+        model.setTrackMidiNote(model.activeTrackID, min(value, 127));
+      else if (ptr > 0 && uiTest.inputTarget() == INPUT_MIDI_CHANNEL)
+        model.setTrackMidiChannel(model.activeTrackID, min(value, 16));
+      else if (ptr > 0 && value >= 30 && value <= 300)
+        model.setBPM(value);
+      uiTest.mode() = UI_MODE_STEP_EDIT;
+    }
+    else if (cmd == CMD_CONFIRM_NO)
+    {
+      uiTest.mode() = UI_MODE_STEP_EDIT;
+    }
+    return;
+  }
+
+  // --- PRIORITY 3: GLOBAL KEYS ---
+  switch (cmd)
+  {
+  case CMD_TRANSPORT_TOGGLE:
+    model.isPlaying() ? model.stop() : model.play();
+    return;
+  case CMD_QUANTIZE_MENU:
+    uiTest.mode() = UI_MODE_QUANTIZE_MENU;
+    return;
+  case CMD_MODE_TOGGLE:
+    uiTest.mode() = (uiTest.mode() == UI_MODE_STEP_EDIT) ? UI_MODE_PERFORM : UI_MODE_STEP_EDIT;
+    return;
+  case CMD_SONG_MODE_TOGGLE:
+    model.setPlayMode(model.getPlayMode() == MODE_PATTERN_LOOP ? MODE_SONG : MODE_PATTERN_LOOP);
+    if (model.getPlayMode() == MODE_SONG)
+      uiTest.bank() = 0;
+    return;
+  case CMD_UNDO:
+    model.undo();
+    return;
+  case CMD_REDO:
+    model.redo();
+    return;
+  case CMD_GATE_WIDTH_ENTER: // Added with gate width, note and channel entry, after the tables
+  case CMD_MIDI_NOTE_ENTER:
+  case CMD_MIDI_CHANNEL_ENTER:
+  case CMD_BPM_ENTER:
+    uiTest.mode() = UI_MODE_NUMBER_INPUT;
+    uiTest.inputTarget() = (NumberInputTarget)(cmd == CMD_BPM_ENTER ? INPUT_BPM : INPUT_GATE_WIDTH + (cmd - CMD_GATE_WIDTH_ENTER));
+    uiTest.inputPtr() = 0;
+    memset(uiTest.inputBuffer(), 0, sizeof(uiTest.inputBuffer()));
+    return;
+  case CMD_CLOCK_SOURCE: // Added with external clock sync, after the tables
+    model.setClockSource((ClockSource)((model.getClockSource() + 1) % NUM_CLOCK_SOURCES));
+    return;
+  default:
+    break;
+  }
+
+  // --- PRIORITY 4: CONTEXT SPECIFIC ---
+  int slot = uiTest.slot();
+  if (model.getPlayMode() == MODE_SONG)
+  {
+    if (cmd >= CMD_PLAYLIST_BANK_1 && cmd <= CMD_PLAYLIST_BANK_4)
+      uiTest.bank() = (cmd - CMD_PLAYLIST_BANK_1) * 16;
+    else if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_16)
+      model.setPlaylistPattern(slot, uiTest.bank() + (cmd - CMD_TRIGGER_1));
+    else if (cmd >= CMD_TRACK_1 && cmd <= CMD_TRACK_8)
+      model.activeTrackID = cmd - CMD_TRACK_1;
+
+    switch (cmd)
+    {
+    case CMD_PLAYLIST_PREV:
+      if (slot > 0)
+        uiTest.slot()--;
+      break;
+    case CMD_PLAYLIST_NEXT:
+      if (slot < model.getPlaylistLength() - 1)
+        uiTest.slot()++;
+      break;
+    case CMD_PLAYLIST_INSERT_PREV:
+      model.insertPlaylistSlot(slot, model.getPlaylistPattern(slot));
+      break;
+    case CMD_PLAYLIST_INSERT_NEXT:
+      model.insertPlaylistSlot(slot + 1, model.getPlaylistPattern(slot));
+      uiTest.slot()++;
+      break;
+    case CMD_PLAYLIST_DELETE:
+      model.deletePlaylistSlot(slot);
+      break;
+    case CMD_PATTERN_NEXT:
+      model.setPlaylistPattern(slot, (model.getPlaylistPattern(slot) + 1) % MAX_PATTERNS);
+      break;
+    case CMD_PATTERN_PREV:
+    {
+      int p = model.getPlaylistPattern(slot) - 1;
+      if (p < 0)
+        p = MAX_PATTERNS - 1;
+      model.setPlaylistPattern(slot, p);
+      break;
+    }
+    default:
+      break;
+    }
+    return;
+  }
+
+  if (cmd >= CMD_TRACK_1 && cmd <= CMD_TRACK_8)
+    model.activeTrackID = cmd - CMD_TRACK_1;
+  else if (cmd >= CMD_TRIGGER_1 && cmd <= CMD_TRIGGER_16)
+    uiTest.trigger(cmd - CMD_TRIGGER_1);
+
+  switch (cmd)
+  {
+  case CMD_PATTERN_PREV:
+    model.prevPattern();
+    break;
+  case CMD_PATTERN_NEXT:
+    model.nextPattern();
+    break;
+  case CMD_TRACK_NEXT:
+    if (model.activeTrackID < NUM_TRACKS - 1)
+      model.activeTrackID++;
+    break;
+  case CMD_TRACK_PREV:
+    if (model.activeTrackID > 0)
+      model.activeTrackID--;
+    break;
+  case CMD_CLEAR_PROMPT:
+    uiTest.mode() = UI_MODE_CONFIRM_CLEAR_TRACK;
+    break;
+  default:
+    break;
+  }
+}
+
+// ----------------------------------------------------------------------
+// MAPPINGS
+// ----------------------------------------------------------------------
+static void test_matrix_bindings_match_legacy()
+{
+  static const PlayMode modes[] = {MODE_PATTERN_LOOP, MODE_SONG, MODE_HARDWARE_TEST};
+  for (PlayMode mode : modes)
+  {
+    model.setPlayMode(mode);
+    model.applyPendingEdits();
+    for (int shift = 0; shift < 2; shift++)
+      for (int id = 0; id < 256; id++)
+      {
+        KeyEvent event = {0, (uint8_t)id, KEY_PRESS, (uint8_t)(shift ? MOD_SHIFT : 0)};
+        InputCommand expected = legacyMatrixCommand(id, shift, mode == MODE_SONG);
+        TEST_ASSERT_EQUAL_INT(expected, uiTest.mapMatrix(event));
+      }
+  }
+}
+
+// The keyboard is now read as HID usage IDs. Every ASCII binding must
+// still hold for the key that types it on a US layout, and anything else
+// bound must be one of the keys added since.
+static int usLayoutKey(int usage)
+{
+  if (usage >= 0x04 && usage <= 0x1D)
+    return 'a' + (usage - 0x04);
+  if (usage >= 0x1E && usage <= 0x26)
+    return '1' + (usage - 0x1E);
+  switch (usage)
+  {
+  case 0x27:
+    return '0';
+  case 0x28:
+    return '\r';
+  case 0x2B:
+    return '\t';
+  case 0x2C:
+    return ' ';
+  case 0x2F:
+    return '[';
+  case 0x30:
+    return ']';
+  default:
+    return -1;
+  }
+}
+
+static InputCommand addedKeyCommand(int usage)
+{
+  if (usage >= 0x22 && usage <= 0x27) // Number row 5-9, 0
+    return (InputCommand)(CMD_TRIGGER_5 + (usage - 0x22));
+  if (usage == 0x58) // Keypad Enter
+    return CMD_SONG_MODE_TOGGLE;
+  if (usage == 0x0E) // K
+    return CMD_CLOCK_SOURCE;
+  if (usage == 0x17) // T
+    return CMD_BPM_ENTER;
+  if (usage == 0x1A) // W
+    return CMD_GATE_WIDTH_ENTER;
+  if (usage == 0x11) // N
+    return CMD_MIDI_NOTE_ENTER;
+  if (usage == 0x10) // M
+    return CMD_MIDI_CHANNEL_ENTER;
+  if (usage == 0x29) // Esc
+    return CMD_CONFIRM_NO;
+  if (usage == 0x2A) // Backspace
+    return CMD_INPUT_DELETE;
+  return CMD_NONE;
+}
+
+static void test_key_bindings_match_legacy()
+{
+  int legacyBound = 0;
+  for (int usage = 0; usage < 256; usage++)
+  {
+    KeyEvent event = {0, (uint8_t)usage, KEY_PRESS, 0};
+    InputCommand expected = legacyKeyCommand(usLayoutKey(usage));
+    if (expected != CMD_NONE)
+      legacyBound++;
+    else
+      expected = addedKeyCommand(usage);
+    TEST_ASSERT_EQUAL_INT(expected, uiTest.mapKey(event));
+  }
+  TEST_ASSERT_EQUAL_INT(20, legacyBound); // All but LF, which no key types
+}
+
+// ----------------------------------------------------------------------
+// DISPATCH
+// ----------------------------------------------------------------------
+struct Snapshot
+{
+  int mode, version, inputPtr, slot, bank;
+  int activeTrack, playMode, playing, quantization, viewPattern, pendingPattern;
+  int clockSource, canUndo, canRedo, centiBPM, inputTarget;
+  char inputBuffer[4];
+  uint8_t gateWidths[NUM_TRACKS], midiNotes[NUM_TRACKS], midiChannels[NUM_TRACKS];
+  int playlist[MAX_SONG_LENGTH + 1];
+  uint32_t stepsHash;
+  uint32_t triggers[host::NUM_GPIO];
+};
+
+static Snapshot snapshot()
+{
+  model.applyPendingEdits();
+
+  Snapshot s;
+  memset(&s, 0, sizeof(s));
+  s.mode = uiTest.mode();
+  s.version = uiTest.version();
+  s.inputPtr = uiTest.inputPtr();
+  memcpy(s.inputBuffer, uiTest.inputBuffer(), sizeof(s.inputBuffer));
+  s.slot = uiTest.slot();
+  s.bank = uiTest.bank();
+  s.activeTrack = model.activeTrackID;
+  s.playMode = model.getPlayMode();
+  s.playing = model.isPlaying();
+  s.quantization = model.getQuantization();
+  s.viewPattern = model.currentViewPatternID;
+  s.pendingPattern = model.getPendingPatternID();
+  s.clockSource = model.getClockSource();
+  s.canUndo = model.canUndo();
+  s.canRedo = model.canRedo();
+  s.centiBPM = model.getCentiBPM();
+  s.inputTarget = uiTest.inputTarget();
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    s.gateWidths[t] = model.getTrackGateWidth(t);
+    s.midiNotes[t] = model.getTrackMidiNote(t);
+    s.midiChannels[t] = model.getTrackMidiChannel(t);
+  }
+  s.playlist[0] = model.getPlaylistLength();
+  for (int i = 0; i < s.playlist[0] && i < MAX_SONG_LENGTH; i++)
+    s.playlist[i + 1] = model.getPlaylistPattern(i);
+  s.stepsHash = 2166136261u;
+  for (int p = 0; p < MAX_PATTERNS; p++)
+    for (int t = 0; t < NUM_TRACKS; t++)
+      s.stepsHash = (s.stepsHash ^ model.getTrackSteps(p, t)) * 16777619u;
+  for (int t = 0; t < NUM_TRACKS; t++)
+    s.stepsHash = (s.stepsHash ^ model.getTrackSwing(t)) * 16777619u;
+  for (int port = 0; port < host::NUM_GPIO; port++)
+    s.triggers[port] = host::gpio[port][33];
+  return s;
+}
+
+struct Context
+{
+  int mode, playMode, playing, track, slot;
+};
+
+static void enter(const Context &c)
+{
+  rebuild();
+  model.insertPlaylistSlot(1, 5);
+  model.insertPlaylistSlot(2, 9);
+  model.toggleStep(2, 3);
+  model.setTrackSwing(2, 40);
+  model.applyPendingEdits();
+  model.setPlayMode((PlayMode)c.playMode);
+  if (c.playing)
+    model.play();
+  model.applyPendingEdits();
+  model.activeTrackID = c.track;
+  uiTest.slot() = c.slot;
+  uiTest.bank() = 16;
+  uiTest.mode() = (InterfaceMode)c.mode;
+  uiTest.inputPtr() = 2;
+  strcpy(uiTest.inputBuffer(), "96");
+  uiTest.inputTarget() = (NumberInputTarget)(c.track % 4); // Every target, across the cursors
+}
+
+// Each command twice in a row, so the state it leads to is exercised too.
+// CMD_NONE is left out: inputs never produce it, and the legacy ladder
+// closed the quantize menu on it where the table ignores it.
+static void test_dispatch_matches_legacy()
+{
+  static const int cursors[4][2] = {{3, 1}, {0, 0}, {6, 2}, {5, 1}}; // Track, slot
+  char message[96];
+
+  for (int mode = UI_MODE_STEP_EDIT; mode <= UI_MODE_QUANTIZE_MENU; mode++)
+    for (int playMode = MODE_PATTERN_LOOP; playMode <= MODE_HARDWARE_TEST; playMode++)
+      for (int playing = 0; playing < 2; playing++)
+        for (const int *cursor : cursors)
+          for (int cmd = CMD_NONE + 1; cmd < NUM_COMMANDS; cmd++)
+          {
+            Context c = {mode, playMode, playing, cursor[0], cursor[1]};
+            snprintf(message, sizeof(message), "ui %d play %d running %d track %d slot %d cmd %d",
+                     mode, playMode, playing, cursor[0], cursor[1], cmd);
+
+            enter(c);
+            legacyHandleCommand((InputCommand)cmd);
+            Snapshot expectedOnce = snapshot();
+            legacyHandleCommand((InputCommand)cmd);
+            Snapshot expectedTwice = snapshot();
+
+            enter(c);
+            ui.handleCommand((InputCommand)cmd);
+            Snapshot actualOnce = snapshot();
+            ui.handleCommand((InputCommand)cmd);
+            Snapshot actualTwice = snapshot();
+
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&expectedOnce, &actualOnce, sizeof(Snapshot), message);
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&expectedTwice, &actualTwice, sizeof(Snapshot), message);
+          }
+}
+
+// ----------------------------------------------------------------------
+// BENCHMARK
+// ----------------------------------------------------------------------
+// A stream of matrix presses over every switch, with and without Shift.
+// Timed twice: mapping alone, and the whole event (map plus dispatch).
+// The handlers are the same on both sides, so the gap is the lookup.
+// Best of a few runs, to keep scheduler noise out of the comparison.
+static KeyEvent benchEvent(int i)
+{
+  KeyEvent event = {0, (uint8_t)(1 + (i * 7) % 31), KEY_PRESS, (uint8_t)((i >> 5) & MOD_SHIFT)};
+  return event;
+}
+
+static InputCommand mapEvent(bool table, const KeyEvent &event)
+{
+  if (table)
+    return uiTest.mapMatrix(event);
+  return legacyMatrixCommand(event.switchID, event.modifiers & MOD_SHIFT, model.getPlayMode() == MODE_SONG);
+}
+
+static double nsPerEvent(bool table, bool dispatch)
+{
+  double best = 1e9;
+  for (int run = 0; run < BENCH_RUNS; run++)
+  {
+    enter({UI_MODE_STEP_EDIT, MODE_PATTERN_LOOP, 0, 3, 1});
+    volatile int sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+    {
+      InputCommand cmd = mapEvent(table, benchEvent(i));
+      sink = sink + cmd;
+      if (!dispatch || cmd == CMD_NONE)
+        continue;
+      if (table)
+        ui.handleCommand(cmd);
+      else
+        legacyHandleCommand(cmd);
+      if ((i & 15) == 15)
+        model.applyPendingEdits(); // As the engine would, keeps the queue moving
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = min(best, elapsed.count() / BENCH_EVENTS);
+  }
+  return best;
+}
+
+// USB keyboards don't repeat, so UsbKeyboard repeats the held key until
+// its release: one press, a hold, then a repeat every KEY_REPEAT_MS
+static void test_usb_key_repeats_until_release()
+{
+  const uint8_t PATTERN_NEXT = 0x30, TRIGGER_1 = 0x1E; // ] and 1
+  uint32_t pressed = host::nowUs;
+  UsbKeyboard::onRawPress(PATTERN_NEXT);
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(1, model.currentViewPatternID);
+
+  host::advanceTo(pressed + (KEY_HOLD_MS + 50) * 1000UL); // Hold only
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(1, model.currentViewPatternID);
+
+  // A stalled loop() gets one repeat, not a burst
+  host::advanceTo(pressed + (KEY_HOLD_MS + 3 * KEY_REPEAT_MS + 50) * 1000UL);
+  ui.processInput();
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(2, model.currentViewPatternID);
+
+  host::advanceTo(host::nowUs + KEY_REPEAT_MS * 1000UL);
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(3, model.currentViewPatternID);
+
+  // Releasing another key leaves the repeat going; releasing it ends it
+  UsbKeyboard::onRawRelease(TRIGGER_1);
+  host::advanceTo(host::nowUs + KEY_REPEAT_MS * 1000UL);
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(4, model.currentViewPatternID);
+
+  UsbKeyboard::onRawRelease(PATTERN_NEXT);
+  host::advanceTo(host::nowUs + 10 * KEY_REPEAT_MS * 1000UL);
+  ui.processInput();
+  TEST_ASSERT_EQUAL_INT(4, model.currentViewPatternID);
+
+  // Keys that don't repeat on the matrix don't repeat here either
+  UsbKeyboard::onRawPress(TRIGGER_1); // Toggles step 1
+  ui.processInput();
+  host::advanceTo(host::nowUs + (KEY_HOLD_MS + 50) * 1000UL);
+  ui.processInput(); // Hold
+  host::advanceTo(host::nowUs + KEY_REPEAT_MS * 1000UL);
+  ui.processInput(); // One repeat
+  model.applyPendingEdits();
+  TEST_ASSERT_EQUAL_INT(1, model.getTrackSteps(model.currentViewPatternID, model.activeTrackID));
+}
+
+static void test_dispatch_benchmark()
+{
+  double legacyMap = nsPerEvent(false, false);
+  double tableMap = nsPerEvent(true, false);
+  double legacyEvent = nsPerEvent(false, true);
+  double tableEvent = nsPerEvent(true, true);
+
+  char message[128];
+  snprintf(message, sizeof(message), "map only: ladders %.1f ns, tables %.1f ns", legacyMap, tableMap);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "per event: ladders %.1f ns, tables %.1f ns", legacyEvent, tableEvent);
+  TEST_MESSAGE(message);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_matrix_bindings_match_legacy);
+  RUN_TEST(test_key_bindings_match_legacy);
+  RUN_TEST(test_dispatch_matches_legacy);
+  RUN_TEST(test_usb_key_repeats_until_release);
+  RUN_TEST(test_dispatch_benchmark);
+  return UNITY_END();
+}
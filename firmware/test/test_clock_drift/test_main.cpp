@@ -0,0 +1,103 @@
+// Long-run accuracy of the internal clock: the step edges played by the
+// engine must land exactly on the ideal integer schedule, so the error
+// against the true period never accumulates, even across the micros() wrap.
+#include <unity.h>
+#include <Arduino.h>
+#include "Engine/ClockEngine.h"
+
+#define RUN_HOURS 2
+#define LOOP_INTERVAL_US 10000 // update() rate; well inside CLOCK_LOOKAHEAD_US
+
+static SequencerModel model; // Too large for the stack
+static OutputDriver driver;
+
+void setUp()
+{
+  host::reset();
+  model.stop();
+}
+void tearDown() {}
+
+// Plays one tempo for RUN_HOURS and checks every step edge
+static void checkTempo(int centiBPM, uint32_t startUs)
+{
+  host::nowUs = startUs;
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(centiBPM);
+  clock.update();
+  model.play();
+  clock.update();
+
+  // A step is TICKS_PER_STEP ticks of 6e9 / PPQN / centiBPM us each.
+  // Step m + 1 is due floor(m * that) after the first one.
+  const uint64_t stepNumerator = 6000000000ULL / PPQN * TICKS_PER_STEP;
+  const double stepUs = (double)stepNumerator / centiBPM;
+
+  uint32_t seen = 0;
+  uint32_t lastEdge = 0;
+  uint64_t elapsed = 0; // Since the first step, unwrapped
+  double maxDrift = 0;
+  uint64_t runUs = (uint64_t)RUN_HOURS * 3600 * 1000000;
+  for (uint64_t t = 0; t < runUs; t += LOOP_INTERVAL_US)
+  {
+    host::advanceTo(startUs + (uint32_t)t);
+    clock.update();
+
+    uint32_t edgeTime;
+    uint32_t count = clock.getStepCount(edgeTime);
+    if (count == seen)
+      continue;
+    // Steps are at least 50 ms apart, so each pass sees at most one
+    TEST_ASSERT_EQUAL_UINT32(seen + 1, count);
+    seen = count;
+    if (count == 1)
+    {
+      TEST_ASSERT_EQUAL_UINT32(startUs + CLOCK_START_DELAY_US, edgeTime);
+      lastEdge = edgeTime;
+      continue;
+    }
+    elapsed += (uint32_t)(edgeTime - lastEdge);
+    lastEdge = edgeTime;
+
+    // floor(m * step), except that an edge due just after another ISR pass
+    // waits out the timer's CLOCK_MIN_DELAY_US floor. That delays this one
+    // edge only; the next is still measured against the schedule.
+    uint64_t m = count - 1;
+    uint64_t ideal = m * stepNumerator / centiBPM;
+    TEST_ASSERT_TRUE_MESSAGE(elapsed >= ideal && elapsed - ideal < CLOCK_MIN_DELAY_US,
+                             "step edge off the exact schedule");
+
+    double drift = m * stepUs - (double)elapsed;
+    if (drift > maxDrift)
+      maxDrift = drift;
+  }
+
+  TEST_ASSERT_TRUE(model.isPlaying());
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getUnderrunCount());
+  uint32_t expectedSteps = (uint32_t)((runUs - CLOCK_START_DELAY_US - LOOP_INTERVAL_US) / stepUs) + 1;
+  TEST_ASSERT_UINT32_WITHIN(1, expectedSteps, seen);
+
+  char message[96];
+  snprintf(message, sizeof(message), "%d.%02d BPM: %lu steps, max drift %.3f us",
+           centiBPM / 100, centiBPM % 100, (unsigned long)seen, maxDrift);
+  TEST_MESSAGE(message);
+}
+
+static void test_drift_30_bpm() { checkTempo(3000, 0); }
+static void test_drift_97_5_bpm() { checkTempo(9750, 123456789); }
+static void test_drift_120_bpm() { checkTempo(12000, 0xF0000000); } // Wraps early
+static void test_drift_173_33_bpm() { checkTempo(17333, 987654321); }
+static void test_drift_300_bpm() { checkTempo(30000, 0xFFFF0000); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_drift_30_bpm);
+  RUN_TEST(test_drift_97_5_bpm);
+  RUN_TEST(test_drift_120_bpm);
+  RUN_TEST(test_drift_173_33_bpm);
+  RUN_TEST(test_drift_300_bpm);
+  return UNITY_END();
+}
@@ -0,0 +1,271 @@
+// Following an external clock: a jittered pulse or MIDI clock stream is fed
+// through ClockSync while the engine plays, and the step edges it renders
+// are compared with the ideal (jitter-free) input pulses.
+#include <unity.h>
+#include <Arduino.h>
+#include <new>
+#include <vector>
+#include "Engine/ClockEngine.h"
+
+#define PULSES_PER_STEP (TICKS_PER_STEP * CLOCK_PULSE_IN_PPQN / PPQN)
+#define SETTLE_US 1000000 // After the lock, before phase is measured
+#define LOOP_US 500       // Longest loop() pass with the display idle
+// ...and with a display frame in it: the full budget, plus USB host work
+#define BUSY_LOOP_US (DISPLAY_BUDGET_US + 500)
+#define NO_RESULTS 0, 0, 0, 0, 0, 0, 0, {}
+
+static SequencerModel model; // Too large for the stack
+static OutputDriver driver;
+
+void setUp()
+{
+  host::reset();
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+}
+void tearDown() {}
+
+// ----------------------------------------------------------------------
+// INPUT STREAM AND LOOP
+// ----------------------------------------------------------------------
+struct SyncRun
+{
+  ClockSource source;
+  int centiBPM;
+  uint32_t jitterUs;  // Each pulse lands uniformly within +-jitterUs
+  uint32_t startUs;   // First pulse (pulse in) or MIDI Start (MIDI)
+  uint32_t stopUs;    // No pulses from here...
+  uint32_t resumeUs;  // ...until here
+  uint32_t endUs;
+  uint32_t loopMaxUs; // Longest loop() pass
+
+  // Results
+  double periodUs;
+  double firstInput;          // Nominal time of the first pulse sent
+  double firstPulse;          // Nominal time of the pulse the run started on
+  uint32_t lockedAt;          // First pass that saw SYNC_LOCKED, 0 if never
+  uint32_t unlockedAt;        // First pass after that without it, 0 if never
+  uint32_t relockedAt;        // Locked again after that, 0 if never
+  uint32_t lastPulse;         // Arrival of the last pulse before stopUs
+  std::vector<uint32_t> edges; // Every step edge
+};
+
+static uint32_t rng = 1;
+static int32_t jitter(uint32_t range)
+{
+  rng = rng * 1664525u + 1013904223u;
+  return range ? (int32_t)((rng >> 8) % (2 * range + 1)) - (int32_t)range : 0;
+}
+
+// loop() passes every 200 us to maxUs, like a busy main loop
+static uint32_t loopGap(uint32_t now, uint32_t maxUs)
+{
+  return 200 + ((now * 2654435761u) >> 8) % (maxUs - 200 + 1);
+}
+
+static void runSync(SyncRun &run)
+{
+  bool midi = (run.source == CLOCK_MIDI_IN);
+  run.periodUs = 60e8 / ((double)run.centiBPM * (midi ? 24 : CLOCK_PULSE_IN_PPQN));
+  run.lockedAt = run.unlockedAt = run.relockedAt = 0;
+  run.edges.clear();
+  rng = 1;
+
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(9000); // The pot tempo, which must be ignored
+  model.setClockSource(run.source);
+  clock.update();
+  if (!midi)
+    model.play(); // Starts on the next pulse
+
+  // MIDI clock runs continuously; Start picks the next pulse as the downbeat
+  double firstNominal = midi ? 100000 : run.startUs;
+  int pulseIndex = 0;
+  auto nominal = [&](int i) { return firstNominal + i * run.periodUs; };
+  run.firstInput = firstNominal;
+  uint32_t nextPulse = (uint32_t)(nominal(0) + jitter(run.jitterUs));
+  uint32_t nextLoop = 1000;
+  int pendingMidi = 0;
+  bool started = !midi;
+  run.firstPulse = -1;
+  uint32_t seenSteps = 0;
+
+  for (;;)
+  {
+    uint32_t now = min(nextPulse, nextLoop);
+    if (now >= run.endUs)
+      break;
+    host::advanceTo(now);
+
+    if (now == nextPulse)
+    {
+      if (run.firstPulse < 0 && started)
+        run.firstPulse = nominal(pulseIndex);
+      if (now < run.stopUs || now >= run.resumeUs)
+      {
+        if (midi)
+          pendingMidi++; // Read by MIDIDevice::read() in loop()
+        else
+          ClockSync::onPulse();
+        if (now < run.stopUs)
+          run.lastPulse = now;
+      }
+      pulseIndex++;
+      nextPulse = (uint32_t)(nominal(pulseIndex) + jitter(run.jitterUs));
+    }
+
+    if (now == nextLoop)
+    {
+      if (!started && now >= run.startUs)
+      {
+        ClockSync::onMidiStart();
+        started = true;
+      }
+      for (; pendingMidi > 0; pendingMidi--)
+        ClockSync::onMidiClock();
+      clock.update();
+
+      uint32_t edgeTime;
+      uint32_t count = clock.getStepCount(edgeTime);
+      if (count != seenSteps)
+      {
+        seenSteps = count;
+        run.edges.push_back(edgeTime);
+      }
+
+      bool locked = (clock.getSyncStatus() == SYNC_LOCKED);
+      if (locked && !run.lockedAt)
+        run.lockedAt = now;
+      else if (!locked && run.lockedAt && !run.unlockedAt)
+        run.unlockedAt = now;
+      else if (locked && run.unlockedAt && !run.relockedAt)
+        run.relockedAt = now;
+
+      nextLoop = now + loopGap(now, run.loopMaxUs);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getUnderrunCount());
+  TEST_ASSERT_INT_WITHIN(50, run.centiBPM, clock.getSyncCentiBPM());
+}
+
+// Step edges from `from` to `to` against the ideal pulses: every edge must
+// sit PULSES_PER_STEP pulses after the one before it, close to its pulse
+static void checkPhase(const SyncRun &run, uint32_t from, uint32_t to, const char *label,
+                       double rmsLimit = SYNC_LOCK_WINDOW_US / 3)
+{
+  double sum = 0, squares = 0, worst = 0;
+  int count = 0;
+  long lastPulse = -1;
+  for (uint32_t edge : run.edges)
+  {
+    if (edge < from || edge >= to)
+      continue;
+    long pulse = lround((edge - run.firstPulse) / run.periodUs);
+    double error = edge - (run.firstPulse + pulse * run.periodUs);
+    TEST_ASSERT_EQUAL_INT32(0, pulse % PULSES_PER_STEP);
+    if (lastPulse >= 0)
+      TEST_ASSERT_EQUAL_INT32(PULSES_PER_STEP, pulse - lastPulse);
+    lastPulse = pulse;
+
+    sum += error;
+    squares += error * error;
+    worst = max(worst, fabs(error));
+    count++;
+  }
+  TEST_ASSERT_TRUE(count > 20);
+
+  double mean = sum / count;
+  double rms = sqrt(squares / count);
+  char message[128];
+  snprintf(message, sizeof(message), "%s: locked %.0f ms after the first pulse, phase mean %.0f rms %.0f max %.0f us",
+           label, (run.lockedAt - run.firstInput) / 1000.0, mean, rms, worst);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_TRUE(rms < rmsLimit);
+  TEST_ASSERT_TRUE(worst < SYNC_LOCK_WINDOW_US);
+}
+
+// ----------------------------------------------------------------------
+// TESTS
+// ----------------------------------------------------------------------
+// 24 PPQN pulses with +-400 us of edge jitter. Locks within a beat and
+// stays locked.
+static void test_pulse_input_locks_and_holds_phase()
+{
+  SyncRun run = {CLOCK_PULSE_IN, 12000, 400, 500000, UINT32_MAX, UINT32_MAX, 20000000, LOOP_US, NO_RESULTS};
+  runSync(run);
+
+  TEST_ASSERT_TRUE(run.lockedAt != 0);
+  TEST_ASSERT_TRUE(run.lockedAt - run.firstInput < 60e6 / 120);
+  TEST_ASSERT_EQUAL_UINT32(0, run.unlockedAt);
+  checkPhase(run, run.lockedAt + SETTLE_US, run.endUs, "pulse 120 BPM");
+}
+
+// MIDI clock is read in loop(), so on top of the source jitter each pulse
+// is stamped up to one loop pass late. The clock runs before Start, which
+// locks on the period alone; the phase has to hold through Start.
+static void test_midi_clock_locks_and_holds_phase()
+{
+  SyncRun run = {CLOCK_MIDI_IN, 9750, 200, 1000000, UINT32_MAX, UINT32_MAX, 20000000, LOOP_US, NO_RESULTS};
+  runSync(run);
+
+  TEST_ASSERT_TRUE(run.lockedAt != 0);
+  TEST_ASSERT_TRUE(run.lockedAt - run.firstInput < 60e6 / 97.5);
+  TEST_ASSERT_EQUAL_UINT32(0, run.unlockedAt);
+  checkPhase(run, run.lockedAt + SETTLE_US, run.endUs, "MIDI 97.5 BPM");
+}
+
+// The same with every loop() pass as long as one that sends a display
+// frame (the worst case: the playhead redraws back to back). The stamping
+// lag grows to a full pass, which the PLL follows as a steady offset of
+// about half a pass; it has to stay inside the lock window.
+static void test_midi_clock_holds_phase_with_display_busy()
+{
+  SyncRun run = {CLOCK_MIDI_IN, 9750, 200, 1000000, UINT32_MAX, UINT32_MAX, 20000000, BUSY_LOOP_US, NO_RESULTS};
+  runSync(run);
+
+  TEST_ASSERT_TRUE(run.lockedAt != 0);
+  TEST_ASSERT_EQUAL_UINT32(0, run.unlockedAt);
+  checkPhase(run, run.lockedAt + SETTLE_US, run.endUs, "MIDI 97.5 BPM, display busy", SYNC_LOCK_WINDOW_US / 2);
+}
+
+// The input goes quiet for 2 s: the lock holds until SYNC_TIMEOUT_MS has
+// passed, playback freewheels at the last tempo, and it relocks once the
+// pulses are back
+static void test_unlocks_on_timeout_and_relocks()
+{
+  SyncRun run = {CLOCK_PULSE_IN, 12000, 100, 500000, 5000000, 7000000, 12000000, LOOP_US, NO_RESULTS};
+  runSync(run);
+
+  TEST_ASSERT_TRUE(run.lockedAt != 0 && run.lockedAt < run.stopUs);
+  TEST_ASSERT_TRUE(run.unlockedAt > run.lastPulse + SYNC_TIMEOUT_MS * 1000UL);
+  TEST_ASSERT_TRUE(run.unlockedAt < run.lastPulse + SYNC_TIMEOUT_MS * 1000UL + 1000);
+
+  // Freewheeling: steps keep coming at the last period
+  int gapSteps = 0;
+  double stepUs = run.periodUs * PULSES_PER_STEP;
+  for (size_t i = 1; i < run.edges.size(); i++)
+    if (run.edges[i] > run.unlockedAt && run.edges[i] < run.resumeUs)
+    {
+      TEST_ASSERT_INT_WITHIN(SYNC_LOCK_WINDOW_US, (int)stepUs, (int)(run.edges[i] - run.edges[i - 1]));
+      gapSteps++;
+    }
+  TEST_ASSERT_TRUE(gapSteps >= 8);
+
+  TEST_ASSERT_TRUE(run.relockedAt > run.resumeUs);
+  TEST_ASSERT_TRUE(run.relockedAt - run.resumeUs < 60e6 / 120);
+  TEST_ASSERT_TRUE(model.isPlaying());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_pulse_input_locks_and_holds_phase);
+  RUN_TEST(test_midi_clock_locks_and_holds_phase);
+  RUN_TEST(test_midi_clock_holds_phase_with_display_busy);
+  RUN_TEST(test_unlocks_on_timeout_and_relocks);
+  return UNITY_END();
+}
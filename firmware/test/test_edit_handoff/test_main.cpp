@@ -0,0 +1,273 @@
+// UI edits queued in loop() and applied by the engine's update(), also in
+// loop(): queuing must never wait, every pass must drain the queue, and
+// an edit is applied whole or not at all, even from another thread.
+#include <unity.h>
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include "Engine/ClockEngine.h"
+
+#define THREAD_EDITS 200000
+#define STALL_TIMEOUT std::chrono::seconds(5) // A lost edit must fail, not hang
+
+static SequencerModel model; // Too large for the stack
+static SequencerModel reference;
+static OutputDriver driver;
+
+void setUp()
+{
+  host::reset();
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+}
+void tearDown() {}
+
+// More toggles than the queue holds in one pass: the excess is dropped and
+// counted, and the call returns
+static void test_full_queue_drops_instead_of_waiting()
+{
+  const int edits = EDIT_QUEUE_SIZE + 8;
+  for (int i = 0; i < edits; i++)
+    model.toggleStep(i / NUM_STEPS, i % NUM_STEPS);
+
+  TEST_ASSERT_EQUAL_UINT32(edits - (EDIT_QUEUE_SIZE - 1), model.getDroppedEditCount());
+  model.applyPendingEdits();
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, model.getTrackSteps(0, 0));
+  TEST_ASSERT_EQUAL_HEX16(0x7FFF, model.getTrackSteps(0, 1));
+}
+
+// Slaved, the run starts on a pulse but renders nothing past the start
+// tick until a second pulse gives the period. Edits still land.
+static void test_slaved_cold_start_drains_every_pass()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setClockSource(CLOCK_PULSE_IN);
+  clock.update();
+  model.play();
+  clock.update();
+
+  host::advanceTo(10000);
+  ClockSync::onPulse();
+  clock.update();
+  TEST_ASSERT_EQUAL_INT(SYNC_SEARCHING, clock.getSyncStatus());
+  TEST_ASSERT_EQUAL_INT(0, clock.getSyncCentiBPM());
+
+  for (int pass = 0; pass < 8; pass++)
+  {
+    host::advanceTo(host::nowUs + 5000);
+    for (int i = 0; i < EDIT_QUEUE_SIZE / 2; i++)
+      model.toggleStep(pass, i);
+    clock.update();
+    TEST_ASSERT_FALSE(model.hasPendingEdits());
+    TEST_ASSERT_EQUAL_HEX16((1 << (EDIT_QUEUE_SIZE / 2)) - 1, model.getTrackSteps(0, pass));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, model.getDroppedEditCount());
+
+  // And stop lands without waiting for the second pulse
+  model.stop();
+  clock.update();
+  TEST_ASSERT_FALSE(model.isPlaying());
+}
+
+// While rendering normally, edits apply on the next pass
+static void test_playing_drains_every_pass()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.play();
+  for (int pass = 0; pass < 40; pass++)
+  {
+    host::advanceTo(host::nowUs + 1000);
+    model.toggleStep(pass % NUM_TRACKS, pass / NUM_TRACKS);
+    clock.update();
+    TEST_ASSERT_FALSE(model.hasPendingEdits());
+  }
+  TEST_ASSERT_EQUAL_HEX16(0x1F, model.getTrackSteps(0, 3));
+}
+
+// A queued pattern change lands in the model a lookahead before it is
+// heard. The playhead follows the outputs, and stop clears it at once.
+static void test_playhead_follows_the_heard_pattern()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(12000);
+  model.play();
+  clock.update();
+  model.setPattern(1); // At the bar
+
+  bool modelAhead = false;
+  int lastStep = 0;
+  while (clock.getPlayheadPattern() == 0)
+  {
+    TEST_ASSERT_TRUE(host::nowUs < 3000000);
+    lastStep = clock.getPlayheadStep();
+    host::advanceTo(host::nowUs + 1000);
+    clock.update();
+    if (model.getPlayingPatternID() == 1 && clock.getPlayheadPattern() == 0)
+      modelAhead = true;
+  }
+  TEST_ASSERT_TRUE(modelAhead);
+  TEST_ASSERT_EQUAL_INT(NUM_STEPS - 1, lastStep);
+  TEST_ASSERT_EQUAL_INT(0, clock.getPlayheadStep());
+
+  for (int pass = 0; pass < 300; pass++)
+  {
+    host::advanceTo(host::nowUs + 1000);
+    clock.update();
+  }
+  TEST_ASSERT_TRUE(clock.getPlayheadStep() > 0);
+  model.stop();
+  clock.update();
+  TEST_ASSERT_EQUAL_INT(0, clock.getPlayheadStep());
+  TEST_ASSERT_EQUAL_INT(0, clock.getPlayheadPattern());
+  host::advanceTo(host::nowUs + 100000);
+  TEST_ASSERT_EQUAL_INT(0, clock.getPlayheadStep());
+}
+
+// Lookahead health is per run: a stall in one run doesn't show in the next
+static void test_lookahead_stats_reset_on_play()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.play();
+  clock.update();
+  host::advanceTo(host::nowUs + 2 * CLOCK_LOOKAHEAD_US);
+  clock.update();
+  TEST_ASSERT_EQUAL_UINT32(1, clock.getUnderrunCount());
+  TEST_ASSERT_TRUE(clock.getMinLeadUs() < 0);
+
+  model.stop();
+  clock.update();
+  model.play();
+  clock.update();
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getUnderrunCount());
+  TEST_ASSERT_EQUAL_INT32(CLOCK_LOOKAHEAD_US, clock.getMinLeadUs());
+}
+
+// Edit i of a fixed sequence mixing every kind of grid edit, so that a
+// second model can replay it
+static void queueEdit(SequencerModel &m, uint32_t i)
+{
+  if (i % 97 == 96)
+    m.undo();
+  else if (i % 50 == 49)
+    m.clearTrack(i % NUM_TRACKS);
+  else if (i % 16 == 15)
+    m.setTrackSwing((i / 16) % NUM_TRACKS, (i * 37) % 101);
+  else
+    m.toggleStep(i % NUM_TRACKS, (i * 7 + i / NUM_TRACKS) % NUM_STEPS);
+}
+
+// Everything playback reads: rows, and the columns and swing masks the
+// fire mask comes from
+static bool sameGrid(const SequencerModel &a, const SequencerModel &b)
+{
+  for (int t = 0; t < NUM_TRACKS; t++)
+    if (a.getTrackSteps(0, t) != b.getTrackSteps(0, t))
+      return false;
+  for (int step = 0; step < NUM_STEPS; step++)
+    for (int tick = 0; tick <= MAX_SWING_TICKS; tick++)
+      if (a.getFireMask(0, step, tick) != b.getFireMask(0, step, tick))
+        return false;
+  return true;
+}
+
+// Spins a little, then sleeps, so that the other side gets the CPU even on
+// a single-core host
+static void backOff(int &misses)
+{
+  if (++misses < 64)
+    std::this_thread::yield();
+  else
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+// The UI queuing from one real thread while the engine applies from
+// another. After every applyPendingEdits() the grid must be exactly what
+// some whole prefix of the sequence leaves: a replay on a second model
+// catches up edit by edit until it matches.
+static void test_threads_never_see_a_torn_edit()
+{
+  static std::atomic<uint32_t> queued; // Edits the producer has got into the queue
+  static std::atomic<bool> failed;     // Consumer gave up: don't wait for room
+  reference.~SequencerModel();
+  new (&reference) SequencerModel();
+  queued = 0;
+  failed = false;
+
+  std::thread producer([] {
+    int misses = 0;
+    for (uint32_t i = 0; i < THREAD_EDITS && !failed; i++)
+    {
+      // A full queue drops the edit and has no other effect: retry it
+      uint32_t dropped = model.getDroppedEditCount();
+      queueEdit(model, i);
+      if (model.getDroppedEditCount() != dropped)
+      {
+        backOff(misses);
+        i--;
+        continue;
+      }
+      misses = 0;
+      queued.store(i + 1, std::memory_order_release);
+    }
+  });
+
+  uint32_t replayed = 0;
+  uint32_t torn = 0;
+  int misses = 0;
+  auto lastEdit = std::chrono::steady_clock::now();
+  while (replayed < THREAD_EDITS || !sameGrid(model, reference))
+  {
+    if (!model.hasPendingEdits())
+    {
+      if (std::chrono::steady_clock::now() - lastEdit > STALL_TIMEOUT)
+        break;
+      backOff(misses);
+      continue;
+    }
+    misses = 0;
+    lastEdit = std::chrono::steady_clock::now();
+    model.applyPendingEdits();
+
+    // One more edit than published may be in: it is queued before it counts
+    uint32_t limit = min(queued.load(std::memory_order_acquire) + 1, (uint32_t)THREAD_EDITS);
+    while (!sameGrid(model, reference) && replayed < limit)
+    {
+      queueEdit(reference, replayed++);
+      reference.applyPendingEdits();
+    }
+    if (!sameGrid(model, reference))
+    {
+      torn++;
+      break;
+    }
+  }
+  failed = true;
+  producer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(THREAD_EDITS, replayed);
+  TEST_ASSERT_FALSE(model.hasPendingEdits());
+  TEST_ASSERT_TRUE(sameGrid(model, reference));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_queue_drops_instead_of_waiting);
+  RUN_TEST(test_slaved_cold_start_drains_every_pass);
+  RUN_TEST(test_playing_drains_every_pass);
+  RUN_TEST(test_playhead_follows_the_heard_pattern);
+  RUN_TEST(test_lookahead_stats_reset_on_play);
+  RUN_TEST(test_threads_never_see_a_torn_edit);
+  return UNITY_END();
+}
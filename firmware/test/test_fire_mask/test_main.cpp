@@ -0,0 +1,115 @@
+// The compiled fire mask against the per-tick track loop it replaced:
+// both must agree on every step and tick, and the lookup must be cheaper.
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include "Model/SequencerModel.h"
+
+#define BENCH_PASSES 20000 // Over a whole 16-step pattern each
+
+static SequencerModel model;
+
+void setUp() {}
+void tearDown() {}
+
+// ClockEngine::_checkTriggers() before the schedule was compiled, as the
+// reference
+__attribute__((noinline)) static uint16_t legacyFireMask(int step, int tick)
+{
+  int patID = model.getPlayingPatternID();
+  uint16_t fireMask = 0;
+
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    uint8_t swingAmount = model.getPlayingTrackSwing(t);
+
+    int targetTick = 0;
+    // Apply delay only to ODD steps (the "ands" of the beat)
+    if (step % 2 != 0)
+    {
+      targetTick = (swingAmount * MAX_SWING_TICKS) / 100;
+    }
+
+    if (tick == targetTick)
+    {
+      uint16_t trackMask = (1 << t);
+      if (model.getTriggersForStep(patID, step) & trackMask)
+      {
+        fireMask |= trackMask;
+      }
+    }
+  }
+  return fireMask;
+}
+
+__attribute__((noinline)) static uint16_t compiledFireMask(int step, int tick)
+{
+  return model.getFireMask(model.getPlayingPatternID(), step, tick);
+}
+
+static void randomPattern(unsigned seed)
+{
+  srand(seed);
+  for (int i = 0; i < 48; i++)
+  {
+    model.toggleStep(rand() % NUM_TRACKS, rand() % 16);
+    model.applyPendingEdits();
+  }
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    model.setTrackSwing(t, rand() % 101);
+    model.applyPendingEdits();
+  }
+}
+
+static void test_fire_mask_matches_legacy_loop()
+{
+  int firing = 0;
+  for (unsigned seed = 1; seed <= 50; seed++)
+  {
+    randomPattern(seed);
+    for (int step = 0; step < 16; step++)
+      for (int tick = 0; tick < TICKS_PER_STEP; tick++)
+      {
+        uint16_t expected = legacyFireMask(step, tick);
+        TEST_ASSERT_EQUAL_HEX16(expected, compiledFireMask(step, tick));
+        if (expected)
+          firing++;
+      }
+  }
+  TEST_ASSERT_TRUE(firing > 50 * 8); // The patterns aren't empty
+}
+
+template <class F>
+static double nsPerTick(F fireMask)
+{
+  volatile uint16_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; pass++)
+    for (int step = 0; step < 16; step++)
+      for (int tick = 0; tick < TICKS_PER_STEP; tick++)
+        sink = sink ^ fireMask(step, tick);
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ((double)BENCH_PASSES * 16 * TICKS_PER_STEP);
+}
+
+static void test_fire_mask_benchmark()
+{
+  randomPattern(7);
+  double legacy = nsPerTick(legacyFireMask);
+  double compiled = nsPerTick(compiledFireMask);
+
+  char message[96];
+  snprintf(message, sizeof(message), "per tick: track loop %.2f ns, compiled %.2f ns (%.1fx)",
+           legacy, compiled, legacy / compiled);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(compiled < legacy);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fire_mask_matches_legacy_loop);
+  RUN_TEST(test_fire_mask_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,218 @@
+// The blitted step grid against the per-cell U8g2 drawing it replaced:
+// both must leave the same frame buffer, without any U8g2 drawing calls.
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include <new>
+#include "View/DisplayManager.h"
+
+#define BENCH_FRAMES 20000
+#define BENCH_RUNS 5
+
+static SequencerModel model; // Too large for the stack
+static OutputDriver driver;
+static ClockEngine clockEngine(model, driver);
+static UIManager ui(model, driver, clockEngine);
+static DisplayManager display(model, ui, clockEngine, 10);
+
+// The grid drawing is private to DisplayManager (a friend)
+struct DisplayManagerTest
+{
+  DisplayManager &display;
+
+  U8G2_SH1106_128X64_NONAME_F_HW_I2C &u8g2() { return display._u8g2; }
+  void buildGridTiles() { display._buildGridTiles(); }
+  void drawGrid() { display._drawGrid(); }
+};
+static DisplayManagerTest displayTest{display};
+
+// The per-cell drawing's U8g2 calls per frame, for any pattern: a font,
+// cursor and glyph per label of the 4 visible rows, four more (box and
+// colours) for the active track's, and one box or pixel per cell
+#define LEGACY_CALLS_PER_FRAME (4 * (3 + NUM_STEPS) + 4)
+
+void setUp()
+{
+  host::reset();
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+  displayTest.buildGridTiles();
+}
+void tearDown() {}
+
+// DisplayManager::_drawGrid() before the cells were pre-rendered, as the
+// reference. Stopped, so no playhead.
+__attribute__((noinline)) static void legacyDrawGrid()
+{
+  U8G2_SH1106_128X64_NONAME_F_HW_I2C &u8g2 = displayTest.u8g2();
+  int stepWidth = 7;
+  int trackHeight = 12;
+  int startY = 16;
+  int visibleRows = 4; // We show 4 tracks at a time
+
+  static int scrollOffset = 0;
+  if (model.activeTrackID >= scrollOffset + visibleRows)
+    scrollOffset = model.activeTrackID - visibleRows + 1;
+  else if (model.activeTrackID < scrollOffset)
+    scrollOffset = model.activeTrackID;
+
+  int viewPattern = model.currentViewPatternID;
+
+  for (int i = 0; i < visibleRows; i++)
+  {
+    int trackIndex = scrollOffset + i;
+    if (trackIndex >= NUM_TRACKS)
+      break;
+
+    uint8_t swing = model.getTrackSwing(trackIndex);
+    uint16_t trackSteps = model.getTrackSteps(viewPattern, trackIndex);
+    int labelY = startY + (i * trackHeight) + 9;
+
+    u8g2.setFont(u8g2_font_profont10_mr);
+
+    if (trackIndex == model.activeTrackID)
+    {
+      u8g2.setDrawColor(1);
+      u8g2.drawBox(115, startY + (i * trackHeight), 12, 11);
+      u8g2.setDrawColor(0);
+      u8g2.setCursor(117, labelY);
+      u8g2.print((char)('A' + trackIndex));
+      u8g2.setDrawColor(1);
+    }
+    else
+    {
+      u8g2.setCursor(117, labelY);
+      u8g2.print((char)('A' + trackIndex));
+    }
+
+    for (int step = 0; step < NUM_STEPS; step++)
+    {
+      int x = step * stepWidth;
+      int y = startY + (i * trackHeight);
+
+      bool isNoteOn = (trackSteps >> step) & 1;
+
+      int boxX = x + 1;
+      int boxW = 6;
+      if ((step % 2 != 0) && (swing > 10))
+      {
+        boxX += 2;
+        boxW -= 2;
+      }
+
+      if (isNoteOn)
+      {
+        u8g2.drawBox(boxX, y, boxW, 8);
+      }
+      else
+      {
+        int dotX = x + 3;
+        if ((step % 2 != 0) && (swing > 10))
+          dotX += 2;
+        u8g2.drawPixel(dotX, y + 4);
+      }
+    }
+  }
+}
+
+__attribute__((noinline)) static void blittedDrawGrid()
+{
+  displayTest.drawGrid();
+}
+
+static void randomPattern(unsigned seed)
+{
+  srand(seed);
+  for (int i = 0; i < 48; i++)
+  {
+    model.toggleStep(rand() % NUM_TRACKS, rand() % NUM_STEPS);
+    model.applyPendingEdits();
+  }
+  for (int t = 0; t < NUM_TRACKS; t++)
+  {
+    model.setTrackSwing(t, rand() % 101);
+    model.applyPendingEdits();
+  }
+}
+
+// Returns the U8g2 calls the grid drawing made
+static uint32_t renderFrame(void (*drawGrid)(), uint8_t *frame)
+{
+  displayTest.u8g2().clearBuffer();
+  uint32_t before = displayTest.u8g2().calls;
+  drawGrid();
+  uint32_t calls = displayTest.u8g2().calls - before;
+  memcpy(frame, displayTest.u8g2().getBufferPtr(), OLED_PAGES * OLED_PAGE_BYTES);
+  return calls;
+}
+
+// Every active track, walked up and down so the view scrolls both ways.
+// The blitted grid makes no U8g2 calls on any of them.
+static void test_grid_matches_legacy_drawing()
+{
+  static uint8_t expected[OLED_PAGES * OLED_PAGE_BYTES];
+  static uint8_t actual[OLED_PAGES * OLED_PAGE_BYTES];
+  static const int tracks[] = {0, 3, 4, 7, 5, 2, 1, 6, 0};
+
+  for (unsigned seed = 1; seed <= 50; seed++)
+  {
+    randomPattern(seed);
+    for (int track : tracks)
+    {
+      model.activeTrackID = track;
+      TEST_ASSERT_EQUAL_UINT32(LEGACY_CALLS_PER_FRAME, renderFrame(legacyDrawGrid, expected));
+      TEST_ASSERT_EQUAL_UINT32(0, renderFrame(blittedDrawGrid, actual));
+      TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    }
+  }
+}
+
+// Best of a few runs, to keep scheduler noise out of the comparison. The
+// buffer isn't cleared between frames, so only the grid drawing is timed.
+static double usPerFrame(void (*drawGrid)())
+{
+  double best = 1e9;
+  for (int run = 0; run < BENCH_RUNS; run++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+      model.activeTrackID = frame % NUM_TRACKS;
+      drawGrid();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    best = min(best, elapsed.count() / BENCH_FRAMES);
+  }
+  return best;
+}
+
+// The host U8G2 stub draws boxes and glyphs far more cheaply than the real
+// library (no font decoding, no clipping, all inline), so the time gap here
+// is a floor and too small to assert on. The call count is the
+// deterministic proxy for what scales on target, and is asserted on.
+static void test_grid_benchmark()
+{
+  static uint8_t frame[OLED_PAGES * OLED_PAGE_BYTES];
+  randomPattern(7);
+  model.activeTrackID = 0;
+  uint32_t legacyCalls = renderFrame(legacyDrawGrid, frame);
+  uint32_t blittedCalls = renderFrame(blittedDrawGrid, frame);
+  double legacy = usPerFrame(legacyDrawGrid);
+  double blitted = usPerFrame(blittedDrawGrid);
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "per frame: U8g2 drawing %.2f us in %u calls, blitted %.2f us in %u calls (%.1fx)",
+           legacy, (unsigned)legacyCalls, blitted, (unsigned)blittedCalls, legacy / blitted);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(LEGACY_CALLS_PER_FRAME, legacyCalls);
+  TEST_ASSERT_EQUAL_UINT32(0, blittedCalls);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_grid_matches_legacy_drawing);
+  RUN_TEST(test_grid_benchmark);
+  return UNITY_END();
+}
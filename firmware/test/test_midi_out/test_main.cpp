@@ -0,0 +1,174 @@
+// MIDI out with loop() busy: every clock and note has to reach USB when
+// it is due, not when loop() next comes round.
+#include <unity.h>
+#include <Arduino.h>
+#include <new>
+#include "Engine/ClockEngine.h"
+
+#define BUSY_LOOP_US 1500 // A loop() pass that sends a display frame, plus USB host work
+#define RUN_US 5000000
+#define START_US 10000
+
+static SequencerModel model; // Too large for the stack
+static OutputDriver driver;
+
+void setUp()
+{
+  host::reset();
+  usbMIDI = usb_midi_class();
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+}
+void tearDown() {}
+
+// When the k-th tick of a run started at `start` is due, on the engine's
+// exact integer schedule
+static uint32_t tickTime(uint32_t start, uint32_t k, uint32_t centiBPM)
+{
+  return start + (uint32_t)((uint64_t)k * (6000000000ULL / PPQN) / centiBPM);
+}
+
+// Plays at 120 BPM with every loop() pass a slow one, then compares each
+// clock's send time with its due time
+static void test_clock_is_sent_when_due_with_loop_busy()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(12000);
+
+  uint32_t now = START_US;
+  host::advanceTo(now);
+  model.play();
+  clock.update();
+  uint32_t start = now + CLOCK_START_DELAY_US;
+
+  while (now < RUN_US)
+  {
+    now += BUSY_LOOP_US;
+    host::advanceTo(now);
+    clock.update();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, clock.getUnderrunCount());
+  TEST_ASSERT_TRUE(usbMIDI.messages < HOST_MIDI_LOG);
+
+  uint32_t clocks = 0, worst = 0;
+  double sum = 0;
+  for (uint32_t i = 0; i < usbMIDI.messages; i++)
+  {
+    const usb_midi_class::Sent &sent = usbMIDI.sent(i);
+    if (sent.status != MIDI_CLOCK)
+      continue;
+    uint32_t due = tickTime(start, clocks * MIDI_CLOCK_DIVIDER, 12000);
+    TEST_ASSERT_TRUE(sent.time >= due);
+    uint32_t latency = sent.time - due;
+    sum += latency;
+    worst = max(worst, latency);
+    clocks++;
+  }
+  TEST_ASSERT_TRUE(clocks > 200);
+
+  char message[128];
+  snprintf(message, sizeof(message), "%u clocks with %u us loop passes: due to sent mean %.0f max %u us",
+           (unsigned)clocks, BUSY_LOOP_US, sum / clocks, (unsigned)worst);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(worst < DISPLAY_BUDGET_US);
+}
+
+// Stop is sent from loop(): it must come after every clock of the run,
+// and nothing may follow it
+static void test_stop_follows_the_last_clock()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(12000);
+
+  uint32_t now = START_US;
+  host::advanceTo(now);
+  model.play();
+  clock.update();
+  for (int pass = 0; pass < 200; pass++)
+  {
+    now += BUSY_LOOP_US;
+    host::advanceTo(now);
+    clock.update();
+    if (pass == 100)
+    {
+      model.stop();
+      clock.update();
+    }
+  }
+
+  int stops = 0;
+  for (uint32_t i = 0; i < usbMIDI.messages; i++)
+  {
+    uint8_t status = usbMIDI.sent(i).status;
+    if (status == MIDI_STOP)
+      stops++;
+    else if (status == MIDI_CLOCK)
+      TEST_ASSERT_EQUAL_INT(0, stops);
+  }
+  TEST_ASSERT_EQUAL_INT(1, stops);
+}
+
+// Notes go out with the same interrupt: a note-on at its gate edge and a
+// note-off at its gate's end, on the track's configured note and channel
+static void test_notes_are_sent_at_the_gate_edges()
+{
+  ClockEngine clock(model, driver);
+  driver.init();
+  clock.init();
+  model.setCentiBPM(12000);
+  for (int step = 0; step < NUM_STEPS; step += 2)
+    model.toggleStep(2, step);
+  model.setTrackMidiNote(2, 40);
+  model.setTrackMidiChannel(2, 3);
+  model.setTrackGateWidth(2, 20);
+
+  uint32_t now = START_US;
+  host::advanceTo(now);
+  model.play();
+  clock.update();
+  uint32_t start = now + CLOCK_START_DELAY_US;
+
+  while (now < 4000000)
+  {
+    now += BUSY_LOOP_US;
+    host::advanceTo(now);
+    clock.update();
+  }
+
+  uint32_t ons = 0, offs = 0, lastOn = 0;
+  for (uint32_t i = 0; i < usbMIDI.messages; i++)
+  {
+    const usb_midi_class::Sent &sent = usbMIDI.sent(i);
+    if ((sent.status & 0xF0) != MIDI_NOTE_ON && (sent.status & 0xF0) != MIDI_NOTE_OFF)
+      continue;
+    TEST_ASSERT_EQUAL_INT(3 - 1, sent.status & 0x0F); // Channel 3
+    TEST_ASSERT_EQUAL_UINT8(40, sent.data1);
+    if ((sent.status & 0xF0) == MIDI_NOTE_ON)
+    {
+      // Every other step
+      TEST_ASSERT_EQUAL_UINT32(tickTime(start, ons * 2 * TICKS_PER_STEP, 12000), sent.time);
+      lastOn = sent.time;
+      ons++;
+    }
+    else
+    {
+      TEST_ASSERT_EQUAL_UINT32(lastOn + 20000, sent.time);
+      offs++;
+    }
+  }
+  TEST_ASSERT_TRUE(ons > 10);
+  TEST_ASSERT_TRUE(offs >= ons - 1);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_clock_is_sent_when_due_with_loop_busy);
+  RUN_TEST(test_stop_follows_the_last_clock);
+  RUN_TEST(test_notes_are_sent_at_the_gate_edges);
+  return UNITY_END();
+}
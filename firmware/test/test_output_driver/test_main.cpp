@@ -0,0 +1,115 @@
+// OutputDriver against mock GPIO registers: every trigger mask must turn
+// into exactly one SET (or CLEAR) write per affected port, with the right
+// bits, and nothing else.
+#include <unity.h>
+#include <Arduino.h>
+#include "Engine/OutputDriver.h"
+
+#define UNTOUCHED 0xDEADBEEF
+#define DR_SET 33
+#define DR_CLEAR 34
+#define DR_TOGGLE 35
+
+// Teensy 4.1: outputs 1-8 on pins 25-32
+static const struct
+{
+  int port;
+  uint32_t bit;
+} OUTPUT_GPIO[NUM_TRACKS] = {
+    {host::GPIO6, 1u << 13}, // Pin 25: GPIO_AD_B0_13
+    {host::GPIO6, 1u << 30}, // Pin 26: GPIO_AD_B1_14
+    {host::GPIO6, 1u << 31}, // Pin 27: GPIO_AD_B1_15
+    {host::GPIO8, 1u << 18}, // Pin 28: GPIO_EMC_32
+    {host::GPIO9, 1u << 31}, // Pin 29: GPIO_EMC_31
+    {host::GPIO8, 1u << 23}, // Pin 30: GPIO_EMC_37
+    {host::GPIO8, 1u << 22}, // Pin 31: GPIO_EMC_36
+    {host::GPIO7, 1u << 12}, // Pin 32: GPIO_B0_12
+};
+
+static OutputDriver driver;
+
+static void poisonRegisters()
+{
+  for (int p = 0; p < host::NUM_GPIO; p++)
+    for (int r = 0; r < 36; r++)
+      host::gpio[p][r] = UNTOUCHED;
+}
+
+// What one call should have written to each port's SET or CLEAR register
+static void expectedWrites(uint16_t mask, uint32_t perPort[host::NUM_GPIO])
+{
+  for (int p = 0; p < host::NUM_GPIO; p++)
+    perPort[p] = 0;
+  for (int t = 0; t < NUM_TRACKS; t++)
+    if (mask & (1 << t))
+      perPort[OUTPUT_GPIO[t].port] |= OUTPUT_GPIO[t].bit;
+}
+
+// Only `reg` may have been written, and only on ports with bits to change
+static void checkWrites(uint16_t mask, int reg)
+{
+  uint32_t expected[host::NUM_GPIO];
+  expectedWrites(mask, expected);
+
+  char message[64];
+  for (int p = 0; p < host::NUM_GPIO; p++)
+    for (int r = 0; r < 36; r++)
+    {
+      uint32_t want = (r == reg && expected[p]) ? expected[p] : UNTOUCHED;
+      snprintf(message, sizeof(message), "mask 0x%02X, port %d, register %d", mask, p, r);
+      TEST_ASSERT_EQUAL_HEX32_MESSAGE(want, host::gpio[p][r], message);
+    }
+}
+
+void setUp()
+{
+  host::reset();
+  driver.init();
+}
+void tearDown() {}
+
+static void test_set_triggers_every_mask()
+{
+  for (int mask = 0; mask < (1 << NUM_TRACKS); mask++)
+  {
+    poisonRegisters();
+    driver.setTriggers(mask);
+    checkWrites(mask, TRIGGER_ON == HIGH ? DR_SET : DR_CLEAR);
+  }
+}
+
+static void test_clear_triggers_every_mask()
+{
+  for (int mask = 0; mask < (1 << NUM_TRACKS); mask++)
+  {
+    poisonRegisters();
+    driver.clearTriggers(mask);
+    checkWrites(mask, TRIGGER_ON == HIGH ? DR_CLEAR : DR_SET);
+  }
+}
+
+static void test_bits_above_the_outputs_are_ignored()
+{
+  poisonRegisters();
+  driver.setTriggers(0xFF00);
+  checkWrites(0, DR_SET);
+  driver.setTriggers(0xFF05);
+  checkWrites(0x05, TRIGGER_ON == HIGH ? DR_SET : DR_CLEAR);
+}
+
+static void test_clear_all_triggers()
+{
+  poisonRegisters();
+  driver.clearAllTriggers();
+  checkWrites(0xFF, TRIGGER_ON == HIGH ? DR_CLEAR : DR_SET);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_set_triggers_every_mask);
+  RUN_TEST(test_clear_triggers_every_mask);
+  RUN_TEST(test_bits_above_the_outputs_are_ignored);
+  RUN_TEST(test_clear_all_triggers);
+  return UNITY_END();
+}
@@ -0,0 +1,183 @@
+// SpscQueue between two real threads: every item arrives once, in order,
+// never half-written, and count() never promises what isn't there.
+#include <unity.h>
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "SpscQueue.h"
+
+#define STRESS_ITEMS 4000000
+#define STALL_TIMEOUT std::chrono::seconds(5) // A lost item must fail, not hang
+
+// Large enough that a torn copy would show up as mismatched fields
+struct Item
+{
+  uint32_t seq;
+  uint32_t words[5];
+};
+
+static Item makeItem(uint32_t seq)
+{
+  Item item;
+  item.seq = seq;
+  for (int i = 0; i < 5; i++)
+    item.words[i] = seq * 2654435761u + i;
+  return item;
+}
+
+static bool isIntact(const Item &item)
+{
+  for (int i = 0; i < 5; i++)
+    if (item.words[i] != item.seq * 2654435761u + i)
+      return false;
+  return true;
+}
+
+// Spins a little, then sleeps, so that the other side gets the CPU even on
+// a single-core host
+static void backOff(int &misses)
+{
+  if (++misses < 64)
+    std::this_thread::yield();
+  else
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_capacity_is_size_minus_one()
+{
+  SpscQueue<Item, 8> queue;
+  Item item;
+  TEST_ASSERT_TRUE(queue.isEmpty());
+  TEST_ASSERT_FALSE(queue.pop(item));
+  TEST_ASSERT_NULL(queue.peek());
+
+  for (uint32_t i = 0; i < 7; i++)
+    TEST_ASSERT_TRUE(queue.push(makeItem(i)));
+  TEST_ASSERT_FALSE(queue.push(makeItem(7)));
+  TEST_ASSERT_EQUAL_UINT16(7, queue.count());
+
+  TEST_ASSERT_EQUAL_UINT32(0, queue.peek()->seq);
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL_UINT32(0, item.seq);
+  TEST_ASSERT_TRUE(queue.push(makeItem(7)));
+
+  queue.clear();
+  TEST_ASSERT_TRUE(queue.isEmpty());
+  TEST_ASSERT_TRUE(queue.push(makeItem(8)));
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL_UINT32(8, item.seq);
+}
+
+// The producer spins on a full queue and the consumer on an empty one, so
+// both ends keep passing each other at full speed
+template <uint16_t SIZE>
+static void stress(uint32_t items, bool usePeek)
+{
+  static SpscQueue<Item, SIZE> queue;
+  static std::atomic<uint32_t> offered; // Items the producer has started to push
+  queue.clear();
+  offered = 0;
+
+  std::thread producer([items] {
+    int misses = 0;
+    for (uint32_t seq = 0; seq < items; seq++)
+    {
+      Item item = makeItem(seq);
+      offered.store(seq + 1, std::memory_order_release);
+      while (!queue.push(item))
+        backOff(misses);
+      misses = 0;
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+  uint32_t overCount = 0; // count() claimed items that were never pushed
+  uint32_t phantoms = 0;  // count() claimed items that pop() didn't find
+  uint32_t owed = 0;      // Pops count() has promised will succeed
+  uint32_t received = 0;
+  int misses = 0;
+  auto lastItem = std::chrono::steady_clock::now();
+  while (expected < items)
+  {
+    // Seen from the consumer, count() is exact for its own pops and can
+    // only lag behind pushes: it may neither exceed what was offered, nor
+    // promise an item the next pops don't get
+    uint16_t count = queue.count();
+    if (count > offered.load(std::memory_order_acquire) - received)
+      overCount++;
+    owed = max(owed, (uint32_t)count);
+
+    Item item;
+    bool got;
+    if (usePeek)
+    {
+      const Item *front = queue.peek();
+      got = (front != nullptr);
+      if (got)
+      {
+        item = *front;
+        Item popped;
+        TEST_ASSERT_TRUE(queue.pop(popped));
+        if (popped.seq != item.seq)
+          outOfOrder++;
+      }
+    }
+    else
+    {
+      got = queue.pop(item);
+    }
+    if (!got)
+    {
+      if (owed)
+        phantoms++;
+      owed = 0;
+      if (std::chrono::steady_clock::now() - lastItem > STALL_TIMEOUT)
+        break;
+      backOff(misses);
+      continue;
+    }
+    misses = 0;
+    lastItem = std::chrono::steady_clock::now();
+    received++;
+    if (owed)
+      owed--;
+
+    if (item.seq != expected)
+      outOfOrder++;
+    if (!isIntact(item))
+      torn++;
+    expected = item.seq + 1; // Resynchronise so one slip is counted once
+  }
+  producer.join();
+
+  Item extra;
+  TEST_ASSERT_FALSE(queue.pop(extra)); // Nothing duplicated at the end
+  TEST_ASSERT_EQUAL_UINT32(items, received);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, overCount);
+  TEST_ASSERT_EQUAL_UINT32(0, phantoms);
+}
+
+// One slot: every item is a handoff, so fewer of them
+static void test_threads_size_2() { stress<2>(STRESS_ITEMS / 40, false); }
+static void test_threads_size_64() { stress<64>(STRESS_ITEMS, false); }
+static void test_threads_size_64_peek() { stress<64>(STRESS_ITEMS, true); }
+static void test_threads_size_1024() { stress<1024>(STRESS_ITEMS, false); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_capacity_is_size_minus_one);
+  RUN_TEST(test_threads_size_2);
+  RUN_TEST(test_threads_size_64);
+  RUN_TEST(test_threads_size_64_peek);
+  RUN_TEST(test_threads_size_1024);
+  return UNITY_END();
+}
@@ -0,0 +1,174 @@
+// Undo journal: a UNDO_DEPTH ring of edit records, where one user action
+// may span several grouped records and may touch any pattern.
+#include <unity.h>
+#include <Arduino.h>
+#include <new>
+#include "Model/SequencerModel.h"
+
+static SequencerModel model; // Too large for the stack
+
+// Edits are only queued by the UI calls; the engine applies them
+static void settle() { model.applyPendingEdits(); }
+
+static void toggle(int track, int step)
+{
+  model.toggleStep(track, step);
+  settle();
+}
+
+static void undo()
+{
+  model.undo();
+  settle();
+}
+
+static void redo()
+{
+  model.redo();
+  settle();
+}
+
+static int undoAll()
+{
+  int actions = 0;
+  while (model.canUndo())
+  {
+    undo();
+    actions++;
+  }
+  return actions;
+}
+
+void setUp()
+{
+  model.~SequencerModel();
+  new (&model) SequencerModel();
+}
+void tearDown() {}
+
+static void test_wraps_after_undo_depth_records()
+{
+  // Every edit flips a distinct bit: track t, step s for t * 16 + s
+  const int edits = UNDO_DEPTH + 10;
+  for (int i = 0; i < edits; i++)
+    toggle(i / NUM_STEPS, i % NUM_STEPS);
+
+  TEST_ASSERT_EQUAL_INT(UNDO_DEPTH, undoAll());
+  // The 10 oldest edits fell off the ring and stay applied
+  for (int i = 0; i < edits; i++)
+  {
+    bool on = model.getTrackSteps(0, i / NUM_STEPS) & (1 << (i % NUM_STEPS));
+    TEST_ASSERT_EQUAL(i < 10, on);
+  }
+
+  // And the rest redo in order
+  for (int i = 0; i < UNDO_DEPTH; i++)
+    redo();
+  TEST_ASSERT_FALSE(model.canRedo());
+  for (int i = 0; i < edits; i++)
+    TEST_ASSERT_TRUE(model.getTrackSteps(0, i / NUM_STEPS) & (1 << (i % NUM_STEPS)));
+}
+
+static void test_grouped_records_undo_as_one()
+{
+  toggle(0, 1);
+  toggle(3, 5);
+  toggle(7, 15);
+  model.clearCurrentPattern(); // One grouped record per non-empty track
+  settle();
+  for (int t = 0; t < NUM_TRACKS; t++)
+    TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(0, t));
+
+  undo();
+  TEST_ASSERT_EQUAL_HEX16(1 << 1, model.getTrackSteps(0, 0));
+  TEST_ASSERT_EQUAL_HEX16(1 << 5, model.getTrackSteps(0, 3));
+  TEST_ASSERT_EQUAL_HEX16(1 << 15, model.getTrackSteps(0, 7));
+  TEST_ASSERT_EQUAL_HEX16((1 << 0) | (1 << 3), model.getTriggersForStep(0, 5) | model.getTriggersForStep(0, 1));
+
+  redo();
+  TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(0, 0) | model.getTrackSteps(0, 3) | model.getTrackSteps(0, 7));
+  TEST_ASSERT_FALSE(model.canRedo());
+
+  // The three toggles underneath are still three actions
+  undo();
+  TEST_ASSERT_EQUAL_INT(3, undoAll());
+}
+
+static void test_wrap_drops_a_broken_group()
+{
+  // An 8-record clear, then enough edits to push its first 4 records out
+  for (int t = 0; t < NUM_TRACKS; t++)
+    toggle(t, 0);
+  model.clearCurrentPattern();
+  settle();
+  const int after = UNDO_DEPTH - NUM_TRACKS + 4;
+  for (int i = 0; i < after; i++)
+    toggle(i % NUM_TRACKS, 1 + i / NUM_TRACKS);
+
+  // The clear can no longer be undone as a whole, so not at all
+  TEST_ASSERT_EQUAL_INT(after, undoAll());
+  for (int t = 0; t < NUM_TRACKS; t++)
+    TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(0, t));
+}
+
+static void test_new_edit_discards_redo()
+{
+  toggle(0, 0);
+  toggle(0, 1);
+  undo();
+  TEST_ASSERT_TRUE(model.canRedo());
+
+  toggle(0, 2);
+  TEST_ASSERT_FALSE(model.canRedo());
+  redo(); // Nothing to redo: step 1 stays off
+  TEST_ASSERT_EQUAL_HEX16(0b101, model.getTrackSteps(0, 0));
+
+  TEST_ASSERT_EQUAL_INT(2, undoAll());
+  TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(0, 0));
+}
+
+static void test_undo_across_patterns()
+{
+  toggle(0, 0); // Pattern 0
+  model.currentViewPatternID = 2;
+  toggle(1, 5);
+  model.setTrackSwing(1, 30); // One pot sweep: one action
+  settle();
+  model.setTrackSwing(1, 60);
+  settle();
+  model.currentViewPatternID = 5;
+  toggle(2, 8);
+  TEST_ASSERT_EQUAL_HEX16(1 << 1, model.getFireMask(2, 5, 60 * MAX_SWING_TICKS / 100));
+
+  // Undo follows the journal, not the pattern on screen
+  model.currentViewPatternID = 0;
+  undo();
+  TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(5, 2));
+  undo();
+  model.currentViewPatternID = 2;
+  TEST_ASSERT_EQUAL_UINT8(0, model.getTrackSwing(1));
+  TEST_ASSERT_EQUAL_HEX16(1 << 5, model.getTrackSteps(2, 1));
+  // The compiled schedule follows: the odd step is no longer delayed
+  TEST_ASSERT_EQUAL_HEX16(1 << 1, model.getFireMask(2, 5, 0));
+
+  redo();
+  TEST_ASSERT_EQUAL_UINT8(60, model.getTrackSwing(1));
+  undo();
+  undo();
+  TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(2, 1));
+  TEST_ASSERT_EQUAL_HEX16(1, model.getTrackSteps(0, 0));
+  undo();
+  TEST_ASSERT_EQUAL_HEX16(0, model.getTrackSteps(0, 0));
+  TEST_ASSERT_FALSE(model.canUndo());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_wraps_after_undo_depth_records);
+  RUN_TEST(test_grouped_records_undo_as_one);
+  RUN_TEST(test_wrap_drops_a_broken_group);
+  RUN_TEST(test_new_edit_discards_redo);
+  RUN_TEST(test_undo_across_patterns);
+  return UNITY_END();
+}